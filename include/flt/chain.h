@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "flt/compat_cast.h"
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/value.h"
+#include "flt/vector_ref.h"
+
+namespace flt
+{
+
+// Number of elements of each intermediate result that are kept live at once
+// while a chain is evaluated. Small enough that the intermediates of a
+// moderately long chain all stay resident in L1/L2.
+constexpr size_t CHAIN_BLOCK_ELEMENTS = 512;
+
+// The element-wise operations that may appear in a flt::chain
+enum class chain_op : uint8_t
+{
+    input,
+    add,
+    mul,
+    scale,
+    conj,
+    abs,
+    convert
+};
+
+// A chain of element-wise operations over flt::vector_ref operands that is
+// built at runtime (e.g. from a configuration file) and evaluated in a single
+// cache-blocked pass. Each call to one of the builder methods appends an
+// operation and returns a handle to its result, which can be used as an
+// argument to later operations. The last operation added is the result of the
+// chain.
+//
+// Evaluation picks a working type using the same rule as the scalar ops (the
+// smallest type that can represent every operand) and dispatches on the types
+// of the operands once up front. After that, the chain is run over blocks of
+// CHAIN_BLOCK_ELEMENTS elements with tight, type-specialized loops, so there
+// is no per-element switch and no full-length temporary per operation.
+//
+// Example:
+//   flt::chain c;
+//   auto x = c.input(0);
+//   auto y = c.input(1);
+//   c.abs(c.scale(c.mul(x, c.conj(y)), 0.5));
+//   c.eval({xRef, yRef}, outRef);
+class chain
+{
+public:
+    // Handle to the result of one operation in the chain
+    using node = uint32_t;
+
+    // Reads element i of inputs[operand]
+    node input(uint32_t operand)
+    {
+        return push({chain_op::input, 0, 0, operand, value(0.0f)});
+    }
+
+    node add(node a, node b)
+    {
+        return push({chain_op::add, a, b, 0, value(0.0f)});
+    }
+
+    node mul(node a, node b)
+    {
+        return push({chain_op::mul, a, b, 0, value(0.0f)});
+    }
+
+    // Multiplies by a constant
+    node scale(node a, value factor)
+    {
+        return push({chain_op::scale, a, 0, 0, factor});
+    }
+
+    // Complex conjugate. Real values are passed through unchanged.
+    node conj(node a)
+    {
+        return push({chain_op::conj, a, 0, 0, value(0.0f)});
+    }
+
+    // Absolute value (magnitude for complex values)
+    node abs(node a)
+    {
+        return push({chain_op::abs, a, 0, 0, value(0.0f)});
+    }
+
+    // Rounds the values to the type with the given index, with the same
+    // semantics as storing them into a vector of that type and reading them
+    // back (e.g. converting to a real type drops the imaginary component).
+    node convert(node a, uint32_t typeIndex)
+    {
+        return push({chain_op::convert, a, 0, typeIndex, value(0.0f)});
+    }
+
+    // Returns the number of operations in the chain
+    size_t size() const
+    {
+        return mNodes.size();
+    }
+
+    // Returns the index of the type the chain would be evaluated in for the
+    // given operands
+    uint32_t workingType(const std::vector<const_vector_ref>& inputs) const
+    {
+        const std::vector<bool> live = liveNodes();
+        uint32_t type = 0;
+        for (size_t i = 0; i < mNodes.size(); ++i)
+        {
+            if (!live[i])
+                continue;
+
+            const instruction& ins = mNodes[i];
+            if (ins.op == chain_op::input)
+                type = std::max(type, inputs[ins.operand].typeIndex());
+            else if (ins.op == chain_op::scale)
+                type = std::max(type, ins.factor.typeIndex());
+        }
+        return type;
+    }
+
+    // Evaluates the chain for every element of the operands, storing the
+    // results in 'out'. All operands must have the same size as 'out'. 'out'
+    // may be one of the operands, since each block is read before it is
+    // written.
+    FLT_KERNEL_API void eval(const std::vector<const_vector_ref>& inputs, vector_ref out) const;
+
+private:
+    struct instruction
+    {
+        chain_op op;
+        node a;
+        node b;
+        uint32_t operand; // Input index for 'input', type index for 'convert'
+        value factor;
+    };
+
+    node push(const instruction& ins)
+    {
+        assert(ins.op == chain_op::input || ins.a < mNodes.size());
+        assert((ins.op != chain_op::add && ins.op != chain_op::mul) || ins.b < mNodes.size());
+        mNodes.push_back(ins);
+        return (node) (mNodes.size() - 1);
+    }
+
+    // Marks the operations that contribute to the result of the chain
+    std::vector<bool> liveNodes() const
+    {
+        std::vector<bool> live(mNodes.size(), false);
+        if (mNodes.empty())
+            return live;
+
+        live.back() = true;
+        for (size_t i = mNodes.size(); i-- > 0;)
+        {
+            if (!live[i])
+                continue;
+
+            const instruction& ins = mNodes[i];
+            switch (ins.op)
+            {
+                case chain_op::input:
+                    break;
+                case chain_op::add:
+                case chain_op::mul:
+                    live[ins.a] = true;
+                    live[ins.b] = true;
+                    break;
+                default:
+                    live[ins.a] = true;
+                    break;
+            }
+        }
+        return live;
+    }
+
+    // Typed block helpers. 'W' is always the working type of the chain.
+    template <class T, class W>
+    static void loadBlock(const uint8_t* src, W* FLT_RESTRICT dst, size_t n)
+    {
+        const T* FLT_RESTRICT in = (const T*) src;
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = compat_cast<W>(in[i]);
+    }
+
+    template <class W, class T>
+    static void storeBlock(const W* FLT_RESTRICT src, uint8_t* dst, size_t n)
+    {
+        T* FLT_RESTRICT out = (T*) dst;
+        for (size_t i = 0; i < n; ++i)
+            out[i] = compat_cast<T>(src[i]);
+    }
+
+    template <class W, class T>
+    static void roundBlock(const W* FLT_RESTRICT src, W* FLT_RESTRICT dst, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = compat_cast<W>(compat_cast<T>(src[i]));
+    }
+
+    template <class W>
+    void evalAs(const std::vector<const_vector_ref>& inputs, vector_ref out) const
+    {
+        using load_fn  = void (*)(const uint8_t*, W*, size_t);
+        using store_fn = void (*)(const W*, uint8_t*, size_t);
+        using round_fn = void (*)(const W*, W*, size_t);
+
+        // Resolve every type-dependent piece of the chain once, up front
+        std::vector<load_fn> loads(inputs.size());
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            loads[i] = dispatch(inputs[i].typeIndex(), [](auto tag) -> load_fn
+            {
+                return &loadBlock<typename decltype(tag)::type, W>;
+            });
+        }
+
+        const store_fn store = dispatch(out.typeIndex(), [](auto tag) -> store_fn
+        {
+            return &storeBlock<W, typename decltype(tag)::type>;
+        });
+
+        std::vector<W> factors(mNodes.size());
+        std::vector<round_fn> rounds(mNodes.size(), nullptr);
+        for (size_t i = 0; i < mNodes.size(); ++i)
+        {
+            if (mNodes[i].op == chain_op::scale)
+                factors[i] = mNodes[i].factor.template as<W>();
+            else if (mNodes[i].op == chain_op::convert)
+            {
+                rounds[i] = dispatch(mNodes[i].operand, [](auto tag) -> round_fn
+                {
+                    return &roundBlock<W, typename decltype(tag)::type>;
+                });
+            }
+        }
+
+        const std::vector<bool> live = liveNodes();
+        std::vector<W> registers(mNodes.size() * CHAIN_BLOCK_ELEMENTS);
+
+        for (size_t first = 0; first < out.size(); first += CHAIN_BLOCK_ELEMENTS)
+        {
+            const size_t n = std::min(CHAIN_BLOCK_ELEMENTS, out.size() - first);
+            for (size_t i = 0; i < mNodes.size(); ++i)
+            {
+                if (!live[i])
+                    continue;
+
+                const instruction& ins = mNodes[i];
+                // Every operation writes a register that none of its arguments
+                // use, so the registers never alias one another.
+                W* FLT_RESTRICT dst     = registers.data() + i * CHAIN_BLOCK_ELEMENTS;
+                const W* FLT_RESTRICT a = registers.data() + ins.a * CHAIN_BLOCK_ELEMENTS;
+                const W* FLT_RESTRICT b = registers.data() + ins.b * CHAIN_BLOCK_ELEMENTS;
+
+                switch (ins.op)
+                {
+                    case chain_op::input:
+                    {
+                        const const_vector_ref& src = inputs[ins.operand];
+                        loads[ins.operand](src.data() + first * src.stride(), dst, n);
+                        break;
+                    }
+
+                    case chain_op::add:
+                        for (size_t j = 0; j < n; ++j)
+                            dst[j] = a[j] + b[j];
+                        break;
+
+                    case chain_op::mul:
+                        for (size_t j = 0; j < n; ++j)
+                            dst[j] = a[j] * b[j];
+                        break;
+
+                    case chain_op::scale:
+                    {
+                        const W factor = factors[i];
+                        for (size_t j = 0; j < n; ++j)
+                            dst[j] = a[j] * factor;
+                        break;
+                    }
+
+                    case chain_op::conj:
+                        if constexpr (is_complex_v<W>)
+                        {
+                            for (size_t j = 0; j < n; ++j)
+                                dst[j] = std::conj(a[j]);
+                        }
+                        else
+                            std::copy(a, a + n, dst);
+                        break;
+
+                    case chain_op::abs:
+                        for (size_t j = 0; j < n; ++j)
+                            dst[j] = W(std::abs(a[j]));
+                        break;
+
+                    case chain_op::convert:
+                        rounds[i](a, dst, n);
+                        break;
+                }
+            }
+
+            const W* result = registers.data() + (mNodes.size() - 1) * CHAIN_BLOCK_ELEMENTS;
+            store(result, out.data() + first * out.stride(), n);
+        }
+    }
+
+    std::vector<instruction> mNodes;
+};
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void chain::eval(const std::vector<const_vector_ref>& inputs, vector_ref out) const
+{
+    assert(!mNodes.empty());
+    for (const instruction& ins : mNodes)
+    {
+        assert(ins.op != chain_op::input || ins.operand < inputs.size());
+        assert(ins.op != chain_op::input || inputs[ins.operand].size() == out.size());
+        (void) ins;
+    }
+
+    dispatch(workingType(inputs), [&](auto tag)
+    {
+        evalAs<typename decltype(tag)::type>(inputs, out);
+    });
+}
+#endif
+
+}
@@ -0,0 +1,552 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/parallel.h"
+#include "flt/vector.h"
+#include "flt/vector_ref.h"
+
+#if FLT_X86_DISPATCH
+    #include <immintrin.h>
+#endif
+
+namespace flt
+{
+
+// Default number of elements in each independently decodable block of a
+// flt::compressed container
+constexpr size_t COMPRESSED_BLOCK_ELEMENTS = 65536;
+
+// Number of scalars a block is decoded in at a time. The expanded byte planes
+// of one chunk stay resident in L1.
+constexpr size_t COMPRESSED_CHUNK = 4096;
+
+// Bytes of zero padding after the last block. The sparse plane decoders read
+// a few bytes past the end of a plane, which may be the end of the last block.
+constexpr size_t COMPRESSED_PADDING = 8;
+
+// How one byte plane of a block is stored
+enum class plane_mode : uint8_t
+{
+    raw,    // n bytes, as is
+    zero,   // every byte is zero, nothing is stored
+    sparse  // a bitmap of the nonzero bytes, followed by the nonzero bytes
+};
+
+// Decoding table for one bitmap byte of a sparse plane: where each of the 8
+// output bytes comes from among the stored nonzero bytes, whether it is kept,
+// and how many stored bytes the group consumes. 'shuffle' is the same
+// information as a byte shuffle control (0x80 clears the byte).
+struct sparse_entry
+{
+    uint8_t position[8];
+    uint8_t mask[8];
+    uint8_t shuffle[8];
+    uint8_t count;
+};
+
+struct sparse_table
+{
+    sparse_entry entries[256];
+
+    constexpr sparse_table() : entries()
+    {
+        for (size_t b = 0; b < 256; ++b)
+        {
+            uint8_t count = 0;
+            for (size_t i = 0; i < 8; ++i)
+            {
+                const bool set = (b >> i) & 1;
+                entries[b].position[i] = set ? count : 0;
+                entries[b].mask[i]     = set ? 0xFF : 0x00;
+                entries[b].shuffle[i]  = set ? count : 0x80;
+                count += set;
+            }
+            entries[b].count = count;
+        }
+    }
+};
+
+inline constexpr sparse_table SPARSE_TABLE {};
+
+// Expands 'groups' groups of 8 bytes of a sparse plane into 'dst', advancing
+// 'src' past the stored bytes that were used. Each bitmap byte is looked up in
+// the table, so the loads within a group are independent of one another.
+struct sparse_expand
+{
+    static void run(uint8_t* FLT_RESTRICT dst, const uint8_t*& src, const uint8_t* map, size_t groups)
+    {
+        const uint8_t* s = src;
+        for (size_t k = 0; k < groups; ++k)
+        {
+            const sparse_entry& e = SPARSE_TABLE.entries[map[k]];
+            for (size_t i = 0; i < 8; ++i)
+                dst[8 * k + i] = s[e.position[i]] & e.mask[i];
+            s += e.count;
+        }
+        src = s;
+    }
+};
+
+#if FLT_X86_DISPATCH
+// Same as sparse_expand, with one byte shuffle per group. Reads up to 8 bytes
+// past the last stored byte, which COMPRESSED_PADDING accounts for.
+struct sparse_expand_shuffle
+{
+    FLT_TARGET_AVX2 static void run(uint8_t* FLT_RESTRICT dst, const uint8_t*& src, const uint8_t* map, size_t groups)
+    {
+        const uint8_t* s = src;
+        for (size_t k = 0; k < groups; ++k)
+        {
+            const sparse_entry& e = SPARSE_TABLE.entries[map[k]];
+            const __m128i bytes   = _mm_loadl_epi64((const __m128i*) s);
+            const __m128i control = _mm_loadl_epi64((const __m128i*) e.shuffle);
+            _mm_storel_epi64((__m128i*) (dst + 8 * k), _mm_shuffle_epi8(bytes, control));
+            s += e.count;
+        }
+        src = s;
+    }
+};
+#endif
+
+// Little helpers for reading and writing unaligned values in the container
+template <class T>
+inline void putBytes(std::vector<uint8_t>& out, T v)
+{
+    const size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &v, sizeof(T));
+}
+
+template <class T>
+inline T getBytes(const uint8_t* in)
+{
+    T v;
+    std::memcpy(&v, in, sizeof(T));
+    return v;
+}
+
+// Encodes 'n' scalars (the raw bits of the floating point values) as one
+// block. Every scalar is XORed with the one LAG positions earlier (the previous
+// value of the same component), the results are split into sizeof(U) byte
+// planes, and each plane is stored in whichever plane_mode is smallest.
+//
+// Block layout: sizeof(U) plane_mode bytes, sizeof(U) uint32_t plane sizes,
+// then the planes in order.
+template <class U, size_t LAG>
+inline void encodeBlock(const U* in, size_t n, std::vector<uint8_t>& out)
+{
+    constexpr size_t W = sizeof(U);
+
+    std::vector<U> delta(n);
+    for (size_t i = 0; i < n; ++i)
+        delta[i] = in[i] ^ (i >= LAG ? in[i - LAG] : U(0));
+
+    const size_t bitmapBytes = (n + 7) / 8;
+    std::vector<uint8_t> planes[W];
+    uint8_t modes[W];
+    std::vector<uint8_t> plane(n);
+    for (size_t p = 0; p < W; ++p)
+    {
+        size_t nonzero = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            plane[i] = uint8_t(delta[i] >> (8 * p));
+            nonzero += plane[i] != 0;
+        }
+
+        if (nonzero == 0)
+            modes[p] = (uint8_t) plane_mode::zero;
+        else if (bitmapBytes + nonzero < n)
+        {
+            modes[p] = (uint8_t) plane_mode::sparse;
+            planes[p].assign(bitmapBytes, 0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (plane[i] != 0)
+                {
+                    planes[p][i >> 3] |= uint8_t(1u << (i & 7));
+                    planes[p].push_back(plane[i]);
+                }
+            }
+        }
+        else
+        {
+            modes[p] = (uint8_t) plane_mode::raw;
+            planes[p] = plane;
+        }
+    }
+
+    for (size_t p = 0; p < W; ++p)
+        out.push_back(modes[p]);
+    for (size_t p = 0; p < W; ++p)
+        putBytes<uint32_t>(out, (uint32_t) planes[p].size());
+    for (size_t p = 0; p < W; ++p)
+        out.insert(out.end(), planes[p].begin(), planes[p].end());
+}
+
+// Decodes one block of 'n' scalars written by encodeBlock() into 'out'.
+// 'scratch' must hold sizeof(U) * COMPRESSED_CHUNK bytes. 'Expand' is the
+// sparse plane expander to use.
+template <class U, size_t LAG, class Expand>
+inline void decodeBlockLoop(const uint8_t* in, size_t n, U* FLT_RESTRICT out, uint8_t* FLT_RESTRICT scratch)
+{
+    constexpr size_t W = sizeof(U);
+    static const uint8_t ZEROS[COMPRESSED_CHUNK] = {};
+
+    uint8_t modes[W];
+    const uint8_t* bitmap[W];
+    const uint8_t* bytes[W];
+    const uint8_t* section = in + W + W * sizeof(uint32_t);
+    for (size_t p = 0; p < W; ++p)
+    {
+        modes[p]  = in[p];
+        bitmap[p] = section;
+        bytes[p]  = modes[p] == (uint8_t) plane_mode::sparse ? section + (n + 7) / 8 : section;
+        section  += getBytes<uint32_t>(in + W + p * sizeof(uint32_t));
+    }
+
+    for (size_t c = 0; c < n; c += COMPRESSED_CHUNK)
+    {
+        const size_t m = std::min(COMPRESSED_CHUNK, n - c);
+
+        // Point every plane at the bytes for this chunk, expanding sparse
+        // planes into the scratch buffer
+        const uint8_t* planes[W] = {};
+        for (size_t p = 0; p < W; ++p)
+        {
+            switch ((plane_mode) modes[p])
+            {
+                case plane_mode::raw:
+                    planes[p] = bytes[p] + c;
+                    break;
+
+                case plane_mode::zero:
+                    planes[p] = ZEROS;
+                    break;
+
+                case plane_mode::sparse:
+                {
+                    uint8_t* dst = scratch + p * COMPRESSED_CHUNK;
+                    Expand::run(dst, bytes[p], bitmap[p] + c / 8, (m + 7) / 8);
+                    planes[p] = dst;
+                    break;
+                }
+            }
+        }
+
+        // Interleave the planes back into words, then undo the XOR delta
+        U* o = out + c;
+        for (size_t i = 0; i < m; ++i)
+        {
+            U w = 0;
+            for (size_t p = 0; p < W; ++p)
+                w |= U(planes[p][i]) << (8 * p);
+            o[i] = w;
+        }
+
+        // The running value of each component is kept in a register rather
+        // than reloaded from the previous store
+        U prev[LAG];
+        for (size_t l = 0; l < LAG; ++l)
+            prev[l] = c == 0 ? U(0) : out[c - LAG + l];
+        for (size_t i = 0; i < m; i += LAG)
+        {
+            for (size_t l = 0; l < LAG; ++l)
+            {
+                prev[l] ^= o[i + l];
+                o[i + l] = prev[l];
+            }
+        }
+    }
+}
+
+// Lossless compressed storage for a vector of any of the four types, meant for
+// archiving captures. The data is split into blocks of a fixed number of
+// elements that are encoded and decoded independently, so both directions run
+// in parallel and any single block can be read on its own.
+//
+// Within a block, each value is XORed with the previous value of the same
+// component, which zeroes the sign, exponent and leading mantissa bits of
+// slowly varying signals. The results are byte-shuffled into planes (all
+// first bytes, then all second bytes, ...), and each plane is stored as raw
+// bytes, as nothing (all zero), or as a bitmap plus its nonzero bytes. Every
+// step is a simple streaming pass, so decoding runs at memory speed.
+//
+// bytes() is a self-contained serialization (in the host byte order) that can
+// be written to disk and read back with the std::vector<uint8_t> constructor.
+//
+// Example:
+//   flt::compressed archive(flt::const_vector_ref(samples));
+//   write(archive.bytes());
+//   ...
+//   flt::compressed loaded(read());
+//   flt::vector restored = loaded.decode();
+class compressed
+{
+public:
+    // Compresses 'src'
+    explicit compressed(const const_vector_ref& src, size_t threads = defaultThreads(),
+        size_t blockElements = COMPRESSED_BLOCK_ELEMENTS) :
+        mSize(src.size()),
+        mBlockElements(blockElements),
+        mIndex(src.typeIndex())
+    {
+        assert(blockElements > 0 && blockElements <= UINT32_MAX);
+        encode(src, threads);
+    }
+
+    // Loads a container previously produced by bytes(). Throws
+    // std::invalid_argument if the data is not a valid container.
+    explicit compressed(std::vector<uint8_t> bytes) :
+        mBytes(std::move(bytes))
+    {
+        if (mBytes.size() < HEADER_BYTES + COMPRESSED_PADDING || std::memcmp(mBytes.data(), MAGIC, 4) != 0)
+            throw std::invalid_argument("flt::compressed: not a compressed container");
+        if (getBytes<uint32_t>(mBytes.data() + 4) != VERSION)
+            throw std::invalid_argument("flt::compressed: unsupported version");
+
+        mIndex         = getBytes<uint32_t>(mBytes.data() + 8);
+        mBlockElements = getBytes<uint32_t>(mBytes.data() + 12);
+        mSize          = getBytes<uint64_t>(mBytes.data() + 16);
+        if (mIndex > 3 || mBlockElements == 0)
+            throw std::invalid_argument("flt::compressed: corrupt header");
+
+        validate();
+    }
+
+    // Decompresses every block into 'out', which must have the same type and
+    // size as the original data
+    void decode(vector_ref out, size_t threads = defaultThreads()) const
+    {
+        assert(out.typeIndex() == mIndex && out.size() == mSize);
+        parallel_for(blocks(), threads, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t b = begin; b < end; ++b)
+                decodeInto(b, out.data() + blockRange(b).begin * out.stride());
+        });
+    }
+
+    // Decompresses every block into a new vector. Large vectors are first
+    // touched by the same number of threads that decode them.
+    vector decode(size_t threads = defaultThreads()) const
+    {
+        vector out = dispatch(mIndex, [&](auto tag)
+        {
+            using T = typename decltype(tag)::type;
+            allocation_policy policy;
+            policy.threads = threads;
+            return vector(mSize, T(0), policy);
+        });
+        decode(vector_ref(out), threads);
+        return out;
+    }
+
+    // Decompresses a single block into 'out', which must have the same type as
+    // the original data and blockRange(block) elements
+    void decodeBlock(size_t block, vector_ref out) const
+    {
+        const index_range r = blockRange(block);
+        assert(out.typeIndex() == mIndex && out.size() == r.end - r.begin);
+        decodeInto(block, out.data());
+        (void) r;
+    }
+
+    // Returns the elements of the original data stored in the given block
+    index_range blockRange(size_t block) const
+    {
+        const size_t begin = block * mBlockElements;
+        return { begin, std::min(begin + mBlockElements, mSize) };
+    }
+
+    // Returns the number of blocks
+    size_t blocks() const
+    {
+        return (mSize + mBlockElements - 1) / mBlockElements;
+    }
+
+    // Returns the number of elements in the original data
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    // Returns the type index of the original data
+    uint32_t typeIndex() const
+    {
+        return mIndex;
+    }
+
+    // Returns the serialized container
+    const std::vector<uint8_t>& bytes() const
+    {
+        return mBytes;
+    }
+
+private:
+    static constexpr uint8_t MAGIC[4]   = {'F', 'L', 'T', 'Z'};
+    static constexpr uint32_t VERSION   = 1;
+    static constexpr size_t HEADER_BYTES = 24;
+
+    const uint8_t* offsets() const
+    {
+        return mBytes.data() + HEADER_BYTES;
+    }
+
+    const uint8_t* payload() const
+    {
+        return offsets() + (blocks() + 1) * sizeof(uint64_t);
+    }
+
+    // Encodes every block of 'src' and builds the serialized container
+    FLT_KERNEL_API void encode(const const_vector_ref& src, size_t threads);
+
+    FLT_KERNEL_API void decodeInto(size_t block, uint8_t* dst) const;
+
+    // Checks that every block lies inside the container and that every plane
+    // holds exactly the bytes its decoder will read, so decoding untrusted
+    // data never reads out of bounds
+    void validate() const
+    {
+        // Every block takes at least one byte, which bounds the block count
+        // before it is used to locate the payload
+        const size_t available = mBytes.size() - COMPRESSED_PADDING - HEADER_BYTES;
+        if (mSize / mBlockElements >= available || (blocks() + 1) * sizeof(uint64_t) > available)
+            throw std::invalid_argument("flt::compressed: truncated block table");
+
+        const size_t count = blocks();
+        const uint8_t* end = mBytes.data() + mBytes.size() - COMPRESSED_PADDING;
+
+        const size_t W   = (mIndex & 1) ? 8 : 4;
+        const size_t lag = mIndex >= 2 ? 2 : 1;
+        for (size_t b = 0; b < count; ++b)
+        {
+            const uint64_t first = getBytes<uint64_t>(offsets() + b * sizeof(uint64_t));
+            const uint64_t last  = getBytes<uint64_t>(offsets() + (b + 1) * sizeof(uint64_t));
+            if (first > last || last > uint64_t(end - payload()))
+                throw std::invalid_argument("flt::compressed: corrupt block table");
+
+            const index_range r  = blockRange(b);
+            const size_t n       = (r.end - r.begin) * lag;
+            const uint8_t* block = payload() + first;
+            uint64_t total       = W + W * sizeof(uint32_t);
+            if (total > last - first)
+                throw std::invalid_argument("flt::compressed: corrupt block");
+
+            const uint8_t* section = block + total;
+            for (size_t p = 0; p < W; ++p)
+            {
+                const size_t bytes = getBytes<uint32_t>(block + W + p * sizeof(uint32_t));
+                bool valid = false;
+                switch ((plane_mode) block[p])
+                {
+                    case plane_mode::raw:
+                        valid = bytes == n;
+                        break;
+                    case plane_mode::zero:
+                        valid = bytes == 0;
+                        break;
+                    case plane_mode::sparse:
+                    {
+                        const size_t bitmapBytes = (n + 7) / 8;
+                        if (bytes < bitmapBytes || total + bytes > last - first)
+                            break;
+                        size_t nonzero = 0;
+                        for (size_t i = 0; i < bitmapBytes; ++i)
+                            nonzero += __builtin_popcount(section[i]);
+                        valid = nonzero == bytes - bitmapBytes && (n % 8 == 0 || (section[bitmapBytes - 1] >> (n % 8)) == 0);
+                        break;
+                    }
+                }
+
+                total   += bytes;
+                section += bytes;
+                if (!valid || total > last - first)
+                    throw std::invalid_argument("flt::compressed: corrupt block");
+            }
+        }
+    }
+
+    std::vector<uint8_t> mBytes;
+    size_t mSize;
+    size_t mBlockElements;
+    uint32_t mIndex;
+};
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void compressed::encode(const const_vector_ref& src, size_t threads)
+{
+    const size_t count = blocks();
+
+    std::vector<std::vector<uint8_t>> encoded(count);
+    dispatch(mIndex, [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        using U = std::conditional_t<sizeof(real_type_t<T>) == 4, uint32_t, uint64_t>;
+        constexpr size_t LAG = is_complex_v<T> ? 2 : 1;
+
+        const U* words = (const U*) src.data();
+        parallel_for(count, threads, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t b = begin; b < end; ++b)
+            {
+                const index_range r = blockRange(b);
+                encodeBlock<U, LAG>(words + r.begin * LAG, (r.end - r.begin) * LAG, encoded[b]);
+            }
+        });
+    });
+
+    // Header, block offsets, blocks, padding
+    mBytes.insert(mBytes.end(), MAGIC, MAGIC + 4);
+    putBytes<uint32_t>(mBytes, VERSION);
+    putBytes<uint32_t>(mBytes, mIndex);
+    putBytes<uint32_t>(mBytes, (uint32_t) mBlockElements);
+    putBytes<uint64_t>(mBytes, mSize);
+
+    uint64_t offset = 0;
+    for (size_t b = 0; b < count; ++b)
+    {
+        putBytes<uint64_t>(mBytes, offset);
+        offset += encoded[b].size();
+    }
+    putBytes<uint64_t>(mBytes, offset);
+
+    for (size_t b = 0; b < count; ++b)
+        mBytes.insert(mBytes.end(), encoded[b].begin(), encoded[b].end());
+    mBytes.resize(mBytes.size() + COMPRESSED_PADDING, 0);
+}
+
+FLT_KERNEL_API void compressed::decodeInto(size_t block, uint8_t* dst) const
+{
+    const index_range r  = blockRange(block);
+    const uint8_t* start = payload() + getBytes<uint64_t>(offsets() + block * sizeof(uint64_t));
+
+    dispatch(mIndex, [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        using U = std::conditional_t<sizeof(real_type_t<T>) == 4, uint32_t, uint64_t>;
+        constexpr size_t LAG = is_complex_v<T> ? 2 : 1;
+
+        // The AVX variants expand sparse planes with byte shuffles
+        using plain = isa_variants<&decodeBlockLoop<U, LAG, sparse_expand>>;
+#if FLT_X86_DISPATCH
+        using shuffle = isa_variants<&decodeBlockLoop<U, LAG, sparse_expand_shuffle>>;
+#else
+        using shuffle = plain;
+#endif
+        const auto fn = pickIsa(&plain::generic, &shuffle::avx2, &shuffle::avx512);
+
+        uint8_t scratch[sizeof(U) * COMPRESSED_CHUNK];
+        fn(start, (r.end - r.begin) * LAG, (U*) dst, scratch);
+    });
+}
+#endif
+
+}
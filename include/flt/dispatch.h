@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include "flt/complex_types.h"
+
+namespace flt
+{
+
+// Identifies one of the four element types without needing a value of it.
+template <class T>
+struct type_tag
+{
+    using type = T;
+};
+
+// Maps a runtime type index (as returned by typeIndex()) to the corresponding
+// element type.
+template <uint32_t I> struct type_at;
+template <> struct type_at<0> { using type = float;   };
+template <> struct type_at<1> { using type = double;  };
+template <> struct type_at<2> { using type = cfloat;  };
+template <> struct type_at<3> { using type = cdouble; };
+
+template <uint32_t I>
+using type_at_t = typename type_at<I>::type;
+
+// Returns the type index of one of the four element types
+template <class T>
+constexpr uint32_t index_of()
+{
+    if constexpr (std::is_same_v<T, float>)
+        return 0;
+    else if constexpr (std::is_same_v<T, double>)
+        return 1;
+    else if constexpr (std::is_same_v<T, cfloat>)
+        return 2;
+    else
+        return 3;
+}
+
+// The smallest type that can represent both A and B (the one with the larger
+// type index). This is the type binary operations are carried out in.
+template <class A, class B>
+using common_t = type_at_t<std::max(index_of<A>(), index_of<B>())>;
+
+// True for cfloat and cdouble
+template <class T> struct is_complex                  { static constexpr bool value = false; };
+template <class T> struct is_complex<std::complex<T>> { static constexpr bool value = true;  };
+
+template <class T>
+inline constexpr bool is_complex_v = is_complex<T>::value;
+
+// The real type underlying T (e.g. float for cfloat)
+template <class T> struct real_type                  { using type = T; };
+template <class T> struct real_type<std::complex<T>> { using type = T; };
+
+template <class T>
+using real_type_t = typename real_type<T>::type;
+
+// Calls f(type_tag<T>()) where T is the element type with the given index.
+// Bulk operations use this to switch on the runtime type once and then run a
+// loop that is specialized for the actual element type, rather than paying
+// for a switch on every element.
+template <class F>
+constexpr decltype(auto) dispatch(uint32_t index, F&& f)
+{
+    switch (index)
+    {
+        case 0:  return f(type_tag<float>());
+        case 1:  return f(type_tag<double>());
+        case 2:  return f(type_tag<cfloat>());
+        default: return f(type_tag<cdouble>());
+    }
+}
+
+}
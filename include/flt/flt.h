@@ -5,3 +5,12 @@
 #include "flt/vector_ref.h"
 #include "flt/vector.h"
 #include "flt/ops.h"
+#include "flt/chain.h"
+#include "flt/compressed.h"
+#include "flt/indexing.h"
+#include "flt/kernel.h"
+#include "flt/matrix.h"
+#include "flt/multichannel.h"
+#include "flt/pipeline.h"
+#include "flt/random.h"
+#include "flt/resampler.h"
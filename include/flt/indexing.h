@@ -0,0 +1,601 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "flt/compat_cast.h"
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/value.h"
+#include "flt/vector_ref.h"
+
+#if FLT_X86_DISPATCH
+    #include <immintrin.h>
+#endif
+
+namespace flt
+{
+
+// A packed array of bits, one per element of a vector. Produced by compare()
+// and consumed by select().
+class mask
+{
+public:
+    explicit mask(size_t size = 0) :
+        mWords((size + 63) / 64, 0),
+        mSize(size)
+    {}
+
+    bool operator[](const size_t index) const
+    {
+        return (mWords[index >> 6] >> (index & 63)) & 1;
+    }
+
+    void set(const size_t index, const bool bit)
+    {
+        const uint64_t m = uint64_t(1) << (index & 63);
+        mWords[index >> 6] = bit ? (mWords[index >> 6] | m) : (mWords[index >> 6] & ~m);
+    }
+
+    // Resizes the mask. Every bit is cleared.
+    void resize(const size_t size)
+    {
+        mWords.assign((size + 63) / 64, 0);
+        mSize = size;
+    }
+
+    // Returns the number of set bits
+    size_t count() const
+    {
+        size_t total = 0;
+        for (uint64_t word : mWords)
+            total += __builtin_popcountll(word);
+        return total;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    // Bit i of the mask is bit (i % 64) of word (i / 64)
+    uint64_t* words()
+    {
+        return mWords.data();
+    }
+
+    const uint64_t* words() const
+    {
+        return mWords.data();
+    }
+
+private:
+    std::vector<uint64_t> mWords;
+    size_t mSize;
+};
+
+// The comparisons supported by compare(). Complex values are ordered by their
+// magnitude. equal and not_equal compare complex values exactly.
+enum class compare_op : uint8_t
+{
+    less,
+    less_equal,
+    greater,
+    greater_equal,
+    equal,
+    not_equal
+};
+
+// -------------------------------------------------------------------------- //
+// Portable typed loops
+
+template <class S, class D>
+inline void gatherLoop(const S* src, const int32_t* indices, D* dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = compat_cast<D>(src[indices[i]]);
+}
+
+template <class S, class D>
+inline void scatterLoop(const S* src, const int32_t* indices, D* dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[indices[i]] = compat_cast<D>(src[i]);
+}
+
+// Returns the value that ordered comparisons of x are based on
+template <class C>
+inline real_type_t<C> compareKey(const C& x)
+{
+    if constexpr (is_complex_v<C>)
+        return std::norm(x);
+    else
+        return x;
+}
+
+template <class C>
+inline bool compareOne(compare_op op, const C& a, const C& b)
+{
+    switch (op)
+    {
+        case compare_op::less:          return compareKey(a) <  compareKey(b);
+        case compare_op::less_equal:    return compareKey(a) <= compareKey(b);
+        case compare_op::greater:       return compareKey(a) >  compareKey(b);
+        case compare_op::greater_equal: return compareKey(a) >= compareKey(b);
+        case compare_op::equal:         return a == b;
+        default:                        return a != b;
+    }
+}
+
+// Compares a[i] with b[i] (or with b[0] for every i when 'broadcast' is set) in
+// the common type C and writes the results to 'words'.
+template <class C, class A, class B>
+inline void compareLoop(compare_op op, const A* a, const B* b, bool broadcast, size_t n, uint64_t* words)
+{
+    for (size_t w = 0; w * 64 < n; ++w)
+    {
+        const size_t count = std::min<size_t>(64, n - w * 64);
+        uint64_t word      = 0;
+        for (size_t j = 0; j < count; ++j)
+        {
+            const size_t i = w * 64 + j;
+            const C lhs    = compat_cast<C>(a[i]);
+            const C rhs    = compat_cast<C>(broadcast ? b[0] : b[i]);
+            word |= uint64_t(compareOne(op, lhs, rhs)) << j;
+        }
+        words[w] = word;
+    }
+}
+
+template <class A, class B, class D>
+inline void selectLoop(const uint64_t* words, const A* a, const B* b, D* dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        const bool bit = (words[i >> 6] >> (i & 63)) & 1;
+        dst[i] = bit ? compat_cast<D>(a[i]) : compat_cast<D>(b[i]);
+    }
+}
+
+// -------------------------------------------------------------------------- //
+// x86 kernels. These only handle operands that all share one element type.
+// Complex floats are moved as 64-bit lanes, since gather, scatter and blend
+// never look at the bits they move. Gathers use the masked forms with a zeroed
+// source: the unmasked intrinsics merge into an undefined register, which GCC
+// reports as -Wmaybe-uninitialized once they are inlined.
+
+#if FLT_X86_DISPATCH
+
+FLT_TARGET_AVX2 inline void gather32Avx2(const float* src, const int32_t* indices, float* dst, size_t n)
+{
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i idx = _mm256_loadu_si256((const __m256i*) (indices + i));
+        _mm256_storeu_ps(dst + i, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), src, idx, all, 4));
+    }
+    gatherLoop(src, indices + i, dst + i, n - i);
+}
+
+FLT_TARGET_AVX2 inline void gather64Avx2(const double* src, const int32_t* indices, double* dst, size_t n)
+{
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i idx = _mm_loadu_si128((const __m128i*) (indices + i));
+        _mm256_storeu_pd(dst + i, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), src, idx, all, 8));
+    }
+    gatherLoop(src, indices + i, dst + i, n - i);
+}
+
+FLT_TARGET_AVX512 inline void gather32Avx512(const float* src, const int32_t* indices, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m512i idx = _mm512_loadu_si512((const void*) (indices + i));
+        _mm512_storeu_ps(dst + i, _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, idx, src, 4));
+    }
+    gatherLoop(src, indices + i, dst + i, n - i);
+}
+
+FLT_TARGET_AVX512 inline void gather64Avx512(const double* src, const int32_t* indices, double* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i idx = _mm256_loadu_si256((const __m256i*) (indices + i));
+        _mm512_storeu_pd(dst + i, _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, src, 8));
+    }
+    gatherLoop(src, indices + i, dst + i, n - i);
+}
+
+// Scatter instructions write overlapping lanes in order, so a repeated index
+// ends up with the last value, just like the scalar loop.
+FLT_TARGET_AVX512 inline void scatter32Avx512(const float* src, const int32_t* indices, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m512i idx = _mm512_loadu_si512((const void*) (indices + i));
+        _mm512_i32scatter_ps(dst, idx, _mm512_loadu_ps(src + i), 4);
+    }
+    scatterLoop(src + i, indices + i, dst, n - i);
+}
+
+FLT_TARGET_AVX512 inline void scatter64Avx512(const double* src, const int32_t* indices, double* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i idx = _mm256_loadu_si256((const __m256i*) (indices + i));
+        _mm512_i32scatter_pd(dst, idx, _mm512_loadu_pd(src + i), 8);
+    }
+    scatterLoop(src + i, indices + i, dst, n - i);
+}
+
+// Full 64-element words are handled with vector compares, the tail with the
+// portable loop.
+template <int Pred>
+FLT_TARGET_AVX2 void compare32Avx2(const float* a, const float* b, bool broadcast, size_t n, uint64_t* words, compare_op op)
+{
+    const size_t full = n / 64;
+    for (size_t w = 0; w < full; ++w)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 8)
+        {
+            const size_t i = w * 64 + j;
+            const __m256 va = _mm256_loadu_ps(a + i);
+            const __m256 vb = broadcast ? _mm256_set1_ps(b[0]) : _mm256_loadu_ps(b + i);
+            word |= uint64_t((uint32_t) _mm256_movemask_ps(_mm256_cmp_ps(va, vb, Pred))) << j;
+        }
+        words[w] = word;
+    }
+    compareLoop<float>(op, a + full * 64, broadcast ? b : b + full * 64, broadcast, n - full * 64, words + full);
+}
+
+template <int Pred>
+FLT_TARGET_AVX2 void compare64Avx2(const double* a, const double* b, bool broadcast, size_t n, uint64_t* words, compare_op op)
+{
+    const size_t full = n / 64;
+    for (size_t w = 0; w < full; ++w)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 4)
+        {
+            const size_t i = w * 64 + j;
+            const __m256d va = _mm256_loadu_pd(a + i);
+            const __m256d vb = broadcast ? _mm256_set1_pd(b[0]) : _mm256_loadu_pd(b + i);
+            word |= uint64_t((uint32_t) _mm256_movemask_pd(_mm256_cmp_pd(va, vb, Pred))) << j;
+        }
+        words[w] = word;
+    }
+    compareLoop<double>(op, a + full * 64, broadcast ? b : b + full * 64, broadcast, n - full * 64, words + full);
+}
+
+template <int Pred>
+FLT_TARGET_AVX512 void compare32Avx512(const float* a, const float* b, bool broadcast, size_t n, uint64_t* words, compare_op op)
+{
+    const size_t full = n / 64;
+    for (size_t w = 0; w < full; ++w)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 16)
+        {
+            const size_t i = w * 64 + j;
+            const __m512 va = _mm512_loadu_ps(a + i);
+            const __m512 vb = broadcast ? _mm512_set1_ps(b[0]) : _mm512_loadu_ps(b + i);
+            word |= uint64_t(_mm512_cmp_ps_mask(va, vb, Pred)) << j;
+        }
+        words[w] = word;
+    }
+    compareLoop<float>(op, a + full * 64, broadcast ? b : b + full * 64, broadcast, n - full * 64, words + full);
+}
+
+template <int Pred>
+FLT_TARGET_AVX512 void compare64Avx512(const double* a, const double* b, bool broadcast, size_t n, uint64_t* words, compare_op op)
+{
+    const size_t full = n / 64;
+    for (size_t w = 0; w < full; ++w)
+    {
+        uint64_t word = 0;
+        for (size_t j = 0; j < 64; j += 8)
+        {
+            const size_t i = w * 64 + j;
+            const __m512d va = _mm512_loadu_pd(a + i);
+            const __m512d vb = broadcast ? _mm512_set1_pd(b[0]) : _mm512_loadu_pd(b + i);
+            word |= uint64_t(_mm512_cmp_pd_mask(va, vb, Pred)) << j;
+        }
+        words[w] = word;
+    }
+    compareLoop<double>(op, a + full * 64, broadcast ? b : b + full * 64, broadcast, n - full * 64, words + full);
+}
+
+FLT_TARGET_AVX2 inline void select32Avx2(const uint64_t* words, const float* a, const float* b, float* dst, size_t n)
+{
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const int m       = (int) ((words[i >> 6] >> (i & 63)) & 0xFF);
+        const __m256i sel = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(m), bits), bits);
+        const __m256 out  = _mm256_blendv_ps(_mm256_loadu_ps(b + i), _mm256_loadu_ps(a + i), _mm256_castsi256_ps(sel));
+        _mm256_storeu_ps(dst + i, out);
+    }
+    for (; i < n; ++i)
+        dst[i] = ((words[i >> 6] >> (i & 63)) & 1) ? a[i] : b[i];
+}
+
+FLT_TARGET_AVX2 inline void select64Avx2(const uint64_t* words, const double* a, const double* b, double* dst, size_t n)
+{
+    const __m256i bits = _mm256_setr_epi64x(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const long long m = (long long) ((words[i >> 6] >> (i & 63)) & 0xF);
+        const __m256i sel = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(m), bits), bits);
+        const __m256d out = _mm256_blendv_pd(_mm256_loadu_pd(b + i), _mm256_loadu_pd(a + i), _mm256_castsi256_pd(sel));
+        _mm256_storeu_pd(dst + i, out);
+    }
+    for (; i < n; ++i)
+        dst[i] = ((words[i >> 6] >> (i & 63)) & 1) ? a[i] : b[i];
+}
+
+// With AVX-512 the mask bits are used directly as a lane mask. When 'dst' is
+// 'b' the unselected lanes are already in place, so only the selected lanes of
+// 'a' are written with a masked store.
+FLT_TARGET_AVX512 inline void select32Avx512(const uint64_t* words, const float* a, const float* b, float* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __mmask16 m = (__mmask16) ((words[i >> 6] >> (i & 63)) & 0xFFFF);
+        if (dst == b)
+            _mm512_mask_storeu_ps(dst + i, m, _mm512_loadu_ps(a + i));
+        else
+            _mm512_storeu_ps(dst + i, _mm512_mask_blend_ps(m, _mm512_loadu_ps(b + i), _mm512_loadu_ps(a + i)));
+    }
+    for (; i < n; ++i)
+        dst[i] = ((words[i >> 6] >> (i & 63)) & 1) ? a[i] : b[i];
+}
+
+FLT_TARGET_AVX512 inline void select64Avx512(const uint64_t* words, const double* a, const double* b, double* dst, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __mmask8 m = (__mmask8) ((words[i >> 6] >> (i & 63)) & 0xFF);
+        if (dst == b)
+            _mm512_mask_storeu_pd(dst + i, m, _mm512_loadu_pd(a + i));
+        else
+            _mm512_storeu_pd(dst + i, _mm512_mask_blend_pd(m, _mm512_loadu_pd(b + i), _mm512_loadu_pd(a + i)));
+    }
+    for (; i < n; ++i)
+        dst[i] = ((words[i >> 6] >> (i & 63)) & 1) ? a[i] : b[i];
+}
+
+#endif
+
+// -------------------------------------------------------------------------- //
+// Each operation takes the instruction set to use, like flt::kernel. It is
+// clamped to the best one the CPU supports, so the default is always the
+// fastest; other values exist so every code path can be tested.
+
+// dst[i] = src[indices[i]], converting to the type of 'dst'. 'dst' must have
+// as many elements as 'indices' and must not overlap 'src'.
+FLT_KERNEL_API void gather(const const_vector_ref& src, const std::vector<int32_t>& indices, vector_ref dst,
+    isa target = detectIsa());
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void gather(const const_vector_ref& src, const std::vector<int32_t>& indices, vector_ref dst,
+    isa target)
+{
+    assert(dst.size() == indices.size());
+    const size_t n = indices.size();
+    target         = std::min(target, detectIsa());
+
+#if FLT_X86_DISPATCH
+    if (target != isa::generic && src.typeIndex() == dst.typeIndex() && src.typeIndex() != 3)
+    {
+        if (src.typeIndex() == 0)
+        {
+            const float* s = (const float*) src.data();
+            float* d       = (float*) dst.data();
+            target == isa::avx512 ? gather32Avx512(s, indices.data(), d, n) : gather32Avx2(s, indices.data(), d, n);
+        }
+        else
+        {
+            const double* s = (const double*) src.data();
+            double* d       = (double*) dst.data();
+            target == isa::avx512 ? gather64Avx512(s, indices.data(), d, n) : gather64Avx2(s, indices.data(), d, n);
+        }
+        return;
+    }
+#endif
+
+    dispatch(src.typeIndex(), [&](auto s)
+    {
+        dispatch(dst.typeIndex(), [&](auto d)
+        {
+            using S = typename decltype(s)::type;
+            using D = typename decltype(d)::type;
+            gatherLoop((const S*) src.data(), indices.data(), (D*) dst.data(), n);
+        });
+    });
+}
+#endif
+
+// dst[indices[i]] = src[i], converting to the type of 'dst'. When an index is
+// repeated, the element with the highest i wins. 'src' must have as many
+// elements as 'indices' and must not overlap 'dst'.
+FLT_KERNEL_API void scatter(const const_vector_ref& src, const std::vector<int32_t>& indices, vector_ref dst,
+    isa target = detectIsa());
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void scatter(const const_vector_ref& src, const std::vector<int32_t>& indices, vector_ref dst,
+    isa target)
+{
+    assert(src.size() == indices.size());
+    const size_t n = indices.size();
+    target         = std::min(target, detectIsa());
+
+#if FLT_X86_DISPATCH
+    // AVX2 has no scatter instruction, so only AVX-512 gets a special case
+    if (target == isa::avx512 && src.typeIndex() == dst.typeIndex() && src.typeIndex() != 3)
+    {
+        if (src.typeIndex() == 0)
+            scatter32Avx512((const float*) src.data(), indices.data(), (float*) dst.data(), n);
+        else
+            scatter64Avx512((const double*) src.data(), indices.data(), (double*) dst.data(), n);
+        return;
+    }
+#endif
+
+    dispatch(src.typeIndex(), [&](auto s)
+    {
+        dispatch(dst.typeIndex(), [&](auto d)
+        {
+            using S = typename decltype(s)::type;
+            using D = typename decltype(d)::type;
+            scatterLoop((const S*) src.data(), indices.data(), (D*) dst.data(), n);
+        });
+    });
+}
+#endif
+
+// Shared implementation of both compare() overloads. 'b' points at either a
+// whole vector or a single value of type index 'bType'.
+FLT_KERNEL_API void compareImpl(const const_vector_ref& a, const uint8_t* b, uint32_t bType, bool broadcast, compare_op op, mask& out,
+    isa target);
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void compareImpl(const const_vector_ref& a, const uint8_t* b, uint32_t bType, bool broadcast, compare_op op, mask& out,
+    isa target)
+{
+    const size_t n = a.size();
+    out.resize(n);
+    target = std::min(target, detectIsa());
+
+#if FLT_X86_DISPATCH
+    if (target != isa::generic && a.typeIndex() == bType && bType < 2)
+    {
+        using f32_fn = void (*)(const float*, const float*, bool, size_t, uint64_t*, compare_op);
+        using f64_fn = void (*)(const double*, const double*, bool, size_t, uint64_t*, compare_op);
+        f32_fn f32 = nullptr;
+        f64_fn f64 = nullptr;
+
+        #define FLT_COMPARE_CASE(OP, PRED)                                                   \
+            case compare_op::OP:                                                             \
+                f32 = target == isa::avx512 ? &compare32Avx512<PRED> : &compare32Avx2<PRED>; \
+                f64 = target == isa::avx512 ? &compare64Avx512<PRED> : &compare64Avx2<PRED>; \
+                break;
+
+        switch (op)
+        {
+            FLT_COMPARE_CASE(less,          _CMP_LT_OQ)
+            FLT_COMPARE_CASE(less_equal,    _CMP_LE_OQ)
+            FLT_COMPARE_CASE(greater,       _CMP_GT_OQ)
+            FLT_COMPARE_CASE(greater_equal, _CMP_GE_OQ)
+            FLT_COMPARE_CASE(equal,         _CMP_EQ_OQ)
+            FLT_COMPARE_CASE(not_equal,     _CMP_NEQ_UQ)
+        }
+        #undef FLT_COMPARE_CASE
+
+        if (bType == 0)
+            f32((const float*) a.data(), (const float*) b, broadcast, n, out.words(), op);
+        else
+            f64((const double*) a.data(), (const double*) b, broadcast, n, out.words(), op);
+        return;
+    }
+#endif
+
+    dispatch(a.typeIndex(), [&](auto ta)
+    {
+        dispatch(bType, [&](auto tb)
+        {
+            using A = typename decltype(ta)::type;
+            using B = typename decltype(tb)::type;
+            compareLoop<common_t<A, B>>(op, (const A*) a.data(), (const B*) b, broadcast, n, out.words());
+        });
+    });
+}
+#endif
+
+// Sets bit i of 'out' to (a[i] op b[i]). The comparison is made in the
+// smallest common type of the operands.
+inline void compare(const const_vector_ref& a, const const_vector_ref& b, compare_op op, mask& out,
+    isa target = detectIsa())
+{
+    assert(a.size() == b.size());
+    compareImpl(a, b.data(), b.typeIndex(), false, op, out, target);
+}
+
+// Sets bit i of 'out' to (a[i] op threshold)
+inline void compare(const const_vector_ref& a, value threshold, compare_op op, mask& out,
+    isa target = detectIsa())
+{
+    dispatch(threshold.typeIndex(), [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        const T t = threshold.as<T>();
+        compareImpl(a, (const uint8_t*) &t, threshold.typeIndex(), true, op, out, target);
+    });
+}
+
+// dst[i] = m[i] ? a[i] : b[i], converting to the type of 'dst'. 'dst' may be
+// one of the inputs.
+FLT_KERNEL_API void select(const mask& m, const const_vector_ref& a, const const_vector_ref& b, vector_ref dst,
+    isa target = detectIsa());
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void select(const mask& m, const const_vector_ref& a, const const_vector_ref& b, vector_ref dst,
+    isa target)
+{
+    assert(m.size() == dst.size() && a.size() == dst.size() && b.size() == dst.size());
+    const size_t n = dst.size();
+    target         = std::min(target, detectIsa());
+
+#if FLT_X86_DISPATCH
+    const uint32_t type = dst.typeIndex();
+    if (target != isa::generic && a.typeIndex() == type && b.typeIndex() == type && type != 3)
+    {
+        if (type == 0)
+        {
+            const float* pa = (const float*) a.data();
+            const float* pb = (const float*) b.data();
+            float* pd       = (float*) dst.data();
+            target == isa::avx512 ? select32Avx512(m.words(), pa, pb, pd, n) : select32Avx2(m.words(), pa, pb, pd, n);
+        }
+        else
+        {
+            const double* pa = (const double*) a.data();
+            const double* pb = (const double*) b.data();
+            double* pd       = (double*) dst.data();
+            target == isa::avx512 ? select64Avx512(m.words(), pa, pb, pd, n) : select64Avx2(m.words(), pa, pb, pd, n);
+        }
+        return;
+    }
+#endif
+
+    dispatch(a.typeIndex(), [&](auto ta)
+    {
+        dispatch(b.typeIndex(), [&](auto tb)
+        {
+            dispatch(dst.typeIndex(), [&](auto td)
+            {
+                using A = typename decltype(ta)::type;
+                using B = typename decltype(tb)::type;
+                using D = typename decltype(td)::type;
+                selectLoop(m.words(), (const A*) a.data(), (const B*) b.data(), (D*) dst.data(), n);
+            });
+        });
+    });
+}
+#endif
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+
+// Bulk kernels are compiled several times with different instruction sets and
+// the best one the CPU supports is picked at runtime. This relies on the GCC /
+// Clang 'target' attribute, so it is only enabled for those compilers on x86.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define FLT_X86_DISPATCH 1
+    #define FLT_TARGET_AVX2   __attribute__((target("avx2,fma")))
+    #define FLT_TARGET_AVX512 __attribute__((target("avx512f,avx512dq,avx512vl,avx2,fma")))
+    #define FLT_FLATTEN       __attribute__((flatten))
+#else
+    #define FLT_X86_DISPATCH 0
+    #define FLT_TARGET_AVX2
+    #define FLT_TARGET_AVX512
+    #define FLT_FLATTEN
+#endif
+
+// Marks a pointer as not aliasing any other pointer in scope. Used by bulk
+// kernels whose outputs are documented not to overlap their inputs.
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+    #define FLT_RESTRICT __restrict
+#else
+    #define FLT_RESTRICT
+#endif
+
+namespace flt
+{
+
+// Instruction sets that bulk kernels may be specialized for, in increasing
+// order of capability.
+enum class isa : uint8_t
+{
+    generic,
+    avx2,
+    avx512
+};
+
+// Returns the most capable instruction set supported by the current CPU. The
+// result is computed once and cached.
+inline isa detectIsa()
+{
+#if FLT_X86_DISPATCH
+    static const isa best = []
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")  &&
+            __builtin_cpu_supports("avx512dq") &&
+            __builtin_cpu_supports("avx512vl"))
+            return isa::avx512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return isa::avx2;
+        return isa::generic;
+    }();
+    return best;
+#else
+    return isa::generic;
+#endif
+}
+
+// Returns the variant of a function to use for the given instruction set.
+// Without x86 dispatch this is always 'generic'.
+template <class F>
+inline F pickIsa(F generic, F avx2, F avx512, isa target = detectIsa())
+{
+#if FLT_X86_DISPATCH
+    switch (target)
+    {
+        case isa::avx512: return avx512;
+        case isa::avx2:   return avx2;
+        default:          break;
+    }
+#endif
+    (void) avx2;
+    (void) avx512;
+    (void) target;
+    return generic;
+}
+
+// Compiles the loop 'Loop' once per instruction set. Bulk kernels write their
+// inner loop as an inline template and take the addresses of these variants
+// (or use select()), so the compiler vectorizes the same source for each ISA:
+//   const auto fn = isa_variants<&philoxFillLoop<float>>::select();
+// The avx2 and avx512 variants are flattened: 'Loop' and everything it calls
+// is inlined into them, however large. Without that, GCC is free to leave a
+// big loop out of line, and the variant becomes a tail call to the generic
+// code. tests/test.cpp checks that this does not happen for the bulk kernels.
+// Without x86 dispatch, the avx2 and avx512 variants just forward to
+// 'generic', so the loop is only compiled once.
+template <auto Loop, class Fn = decltype(Loop)>
+struct isa_variants;
+
+template <auto Loop, class R, class... Args>
+struct isa_variants<Loop, R (*)(Args...)>
+{
+    using function = R (*)(Args...);
+
+    static R generic(Args... args)
+    {
+        return Loop(args...);
+    }
+
+#if FLT_X86_DISPATCH
+    FLT_TARGET_AVX2 FLT_FLATTEN static R avx2(Args... args)
+    {
+        return Loop(args...);
+    }
+
+    FLT_TARGET_AVX512 FLT_FLATTEN static R avx512(Args... args)
+    {
+        return Loop(args...);
+    }
+#else
+    static R avx2(Args... args)
+    {
+        return generic(args...);
+    }
+
+    static R avx512(Args... args)
+    {
+        return generic(args...);
+    }
+#endif
+
+    // Returns the variant for 'target'
+    static function select(isa target = detectIsa())
+    {
+        return pickIsa<function>(&generic, &avx2, &avx512, target);
+    }
+};
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include "flt/compat_cast.h"
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/vector_ref.h"
+
+namespace flt
+{
+
+// The element-wise operations that can be bound to a flt::kernel
+enum class kernel_op : uint8_t
+{
+    add,
+    sub,
+    mul,
+    div
+};
+
+// Typed loops that back flt::kernel. Each computes out[i] = lhs[i] op rhs[i]
+// in the smallest common type of the two operands (the same rule used by the
+// scalar operators) and converts the result to the type of 'out'.
+template <class Op, class O, class A, class B>
+inline void binaryLoop(uint8_t* out, const uint8_t* lhs, const uint8_t* rhs, size_t n)
+{
+    using C = common_t<A, B>;
+
+    O* o       = (O*) out;
+    const A* a = (const A*) lhs;
+    const B* b = (const B*) rhs;
+
+    const Op op;
+    for (size_t i = 0; i < n; ++i)
+        o[i] = compat_cast<O>(op(compat_cast<C>(a[i]), compat_cast<C>(b[i])));
+}
+
+// Signature shared by every binary loop: (out, lhs, rhs, n)
+using binary_fn = void (*)(uint8_t*, const uint8_t*, const uint8_t*, size_t);
+
+// Returns the loop that computes 'op' for the given operand types with the
+// given instruction set
+FLT_KERNEL_API binary_fn binaryKernel(kernel_op op, uint32_t outType, uint32_t lhsType, uint32_t rhsType, isa target);
+
+// A binary element-wise operation bound to a fixed set of operand types.
+// Constructing a kernel resolves the four-way type switch for each operand and
+// the instruction set to use exactly once, producing a plain function pointer.
+// Calling the kernel afterwards only checks that the operands still have the
+// types it was built for and then jumps straight into a type-specialized loop.
+// This is the preferred way to apply the same operation to many small blocks.
+//
+// Example:
+//   flt::kernel k(flt::kernel_op::mul, out.typeIndex(), a.typeIndex(), b.typeIndex());
+//   for (auto& block : blocks)
+//       k(block.out, block.a, block.b);
+class kernel
+{
+public:
+    using function = binary_fn;
+
+    // 'target' is clamped to the best instruction set the CPU supports
+    kernel(kernel_op op, uint32_t outType, uint32_t lhsType, uint32_t rhsType, isa target = detectIsa()) :
+        mFunction(nullptr),
+        mOutType(outType),
+        mLhsType(lhsType),
+        mRhsType(rhsType),
+        mIsa(std::min(target, detectIsa()))
+    {
+        mFunction = binaryKernel(op, outType, lhsType, rhsType, mIsa);
+    }
+
+    // Binds the kernel to the types of the given operands
+    kernel(kernel_op op, const const_vector_ref& out, const const_vector_ref& lhs, const const_vector_ref& rhs, isa target = detectIsa()) :
+        kernel(op, out.typeIndex(), lhs.typeIndex(), rhs.typeIndex(), target)
+    {}
+
+    // Computes out[i] = lhs[i] op rhs[i] for every element. Throws
+    // std::invalid_argument if any operand does not have the type the kernel
+    // was built for.
+    void operator()(vector_ref out, const const_vector_ref& lhs, const const_vector_ref& rhs) const
+    {
+        if (out.typeIndex() != mOutType || lhs.typeIndex() != mLhsType || rhs.typeIndex() != mRhsType)
+            throw std::invalid_argument("flt::kernel: operand types do not match the kernel");
+
+        assert(lhs.size() == out.size() && rhs.size() == out.size());
+        mFunction(out.data(), lhs.data(), rhs.data(), out.size());
+    }
+
+    // Returns the resolved function. Calling it directly skips the type check.
+    function get() const
+    {
+        return mFunction;
+    }
+
+    // Returns the instruction set the kernel was resolved for
+    isa target() const
+    {
+        return mIsa;
+    }
+
+private:
+    function mFunction;
+    uint32_t mOutType;
+    uint32_t mLhsType;
+    uint32_t mRhsType;
+    isa mIsa;
+};
+
+#if FLT_KERNEL_DEFINITIONS
+template <class Op, class O, class A, class B>
+binary_fn binarySelect(isa target)
+{
+    return isa_variants<&binaryLoop<Op, O, A, B>>::select(target);
+}
+
+template <class Op>
+binary_fn binaryResolve(uint32_t outType, uint32_t lhsType, uint32_t rhsType, isa target)
+{
+    return dispatch(outType, [&](auto o)
+    {
+        return dispatch(lhsType, [&](auto a)
+        {
+            return dispatch(rhsType, [&](auto b)
+            {
+                using O = typename decltype(o)::type;
+                using A = typename decltype(a)::type;
+                using B = typename decltype(b)::type;
+                return binarySelect<Op, O, A, B>(target);
+            });
+        });
+    });
+}
+
+FLT_KERNEL_API binary_fn binaryKernel(kernel_op op, uint32_t outType, uint32_t lhsType, uint32_t rhsType, isa target)
+{
+    switch (op)
+    {
+        case kernel_op::add: return binaryResolve<std::plus<>>(outType, lhsType, rhsType, target);
+        case kernel_op::sub: return binaryResolve<std::minus<>>(outType, lhsType, rhsType, target);
+        case kernel_op::mul: return binaryResolve<std::multiplies<>>(outType, lhsType, rhsType, target);
+        default:             return binaryResolve<std::divides<>>(outType, lhsType, rhsType, target);
+    }
+}
+#endif
+
+}
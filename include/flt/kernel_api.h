@@ -0,0 +1,27 @@
+#pragma once
+
+// flt can be used header-only (the default), or with its bulk kernels compiled
+// once into the flt_kernels library (the LIBFLT_BUILD_KERNELS CMake option),
+// which defines FLT_PRECOMPILED_KERNELS for everything that links against it.
+//
+// The bulk operations are split into entry points that switch on the element
+// types and instruction set, and the type- and ISA-specialized loop templates
+// they select from. Instantiating every combination of those templates is
+// what makes the headers expensive to compile. With FLT_PRECOMPILED_KERNELS,
+// the headers only declare the entry points, so translation units that use
+// them instantiate nothing. src/kernels.cpp defines FLT_BUILDING_KERNELS and
+// includes the headers to provide the one shared definition of each.
+
+// Linkage of the entry points: inline when header-only, external otherwise
+#if defined(FLT_PRECOMPILED_KERNELS)
+    #define FLT_KERNEL_API
+#else
+    #define FLT_KERNEL_API inline
+#endif
+
+// 1 if this translation unit should see the definitions of the entry points
+#if defined(FLT_PRECOMPILED_KERNELS) && !defined(FLT_BUILDING_KERNELS)
+    #define FLT_KERNEL_DEFINITIONS 0
+#else
+    #define FLT_KERNEL_DEFINITIONS 1
+#endif
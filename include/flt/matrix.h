@@ -0,0 +1,633 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "flt/compat_cast.h"
+#include "flt/complex_types.h"
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/parallel.h"
+#include "flt/value.h"
+#include "flt/value_ref.h"
+#include "flt/vector_ref.h"
+
+namespace flt
+{
+
+// How the elements of a matrix are arranged in memory. Consecutive rows (for
+// row_major) or columns (for col_major) are 'leading dimension' elements apart.
+enum class matrix_layout : uint8_t
+{
+    row_major,
+    col_major
+};
+
+// A dense matrix of floats, doubles, complex floats, or complex doubles that
+// manages its own memory. Elements are stored contiguously (the leading
+// dimension is the row or column length).
+class matrix
+{
+public:
+    matrix(size_t rows, size_t cols, float val, matrix_layout layout = matrix_layout::row_major) :
+        matrix(rows, cols, layout, sizeof(float), 0)
+    {
+        std::fill((float*) mData, (float*) mData + rows * cols, val);
+    }
+
+    matrix(size_t rows, size_t cols, double val, matrix_layout layout = matrix_layout::row_major) :
+        matrix(rows, cols, layout, sizeof(double), 1)
+    {
+        std::fill((double*) mData, (double*) mData + rows * cols, val);
+    }
+
+    matrix(size_t rows, size_t cols, cfloat val, matrix_layout layout = matrix_layout::row_major) :
+        matrix(rows, cols, layout, sizeof(cfloat), 2)
+    {
+        std::fill((cfloat*) mData, (cfloat*) mData + rows * cols, val);
+    }
+
+    matrix(size_t rows, size_t cols, cdouble val, matrix_layout layout = matrix_layout::row_major) :
+        matrix(rows, cols, layout, sizeof(cdouble), 3)
+    {
+        std::fill((cdouble*) mData, (cdouble*) mData + rows * cols, val);
+    }
+
+    matrix(const matrix& other) = delete;
+    matrix& operator=(const matrix& other) = delete;
+
+    ~matrix()
+    {
+        delete[] mData;
+    }
+
+    value_ref operator()(const size_t row, const size_t col)
+    {
+        return value_ref(mData + offset(row, col) * mStride, mIndex);
+    }
+
+    const_value_ref operator()(const size_t row, const size_t col) const
+    {
+        return const_value_ref(mData + offset(row, col) * mStride, mIndex);
+    }
+
+    // Returns the position (in elements) of the given element in memory
+    constexpr size_t offset(const size_t row, const size_t col) const
+    {
+        return mLayout == matrix_layout::row_major ? row * mCols + col : col * mRows + row;
+    }
+
+    constexpr size_t rows() const
+    {
+        return mRows;
+    }
+
+    constexpr size_t cols() const
+    {
+        return mCols;
+    }
+
+    constexpr matrix_layout layout() const
+    {
+        return mLayout;
+    }
+
+    // Returns a pointer to the first byte of the underlying storage
+    constexpr uint8_t* data() const
+    {
+        return mData;
+    }
+
+    // Returns the index of the currently active type
+    constexpr uint32_t typeIndex() const
+    {
+        return mIndex;
+    }
+
+private:
+    matrix(size_t rows, size_t cols, matrix_layout layout, uint32_t stride, uint32_t index) :
+        mData(new uint8_t[stride * rows * cols]),
+        mRows(rows),
+        mCols(cols),
+        mStride(stride),
+        mIndex(index),
+        mLayout(layout)
+    {}
+
+    uint8_t* mData;
+    size_t mRows;
+    size_t mCols;
+    uint32_t mStride;
+    uint32_t mIndex;
+    matrix_layout mLayout;
+};
+
+// Type erased, non-owning view of a dense matrix stored in a std::vector (or a
+// flt::matrix). A leading dimension of 0 means the rows (or columns) are packed
+// back to back.
+class matrix_ref
+{
+public:
+    matrix_ref(std::vector<float>& src, size_t rows, size_t cols,
+        matrix_layout layout = matrix_layout::row_major, size_t ld = 0) :
+        matrix_ref((uint8_t*) src.data(), rows, cols, layout, ld, sizeof(float), 0)
+    {
+        assert(src.size() >= required());
+    }
+
+    matrix_ref(std::vector<double>& src, size_t rows, size_t cols,
+        matrix_layout layout = matrix_layout::row_major, size_t ld = 0) :
+        matrix_ref((uint8_t*) src.data(), rows, cols, layout, ld, sizeof(double), 1)
+    {
+        assert(src.size() >= required());
+    }
+
+    matrix_ref(std::vector<cfloat>& src, size_t rows, size_t cols,
+        matrix_layout layout = matrix_layout::row_major, size_t ld = 0) :
+        matrix_ref((uint8_t*) src.data(), rows, cols, layout, ld, sizeof(cfloat), 2)
+    {
+        assert(src.size() >= required());
+    }
+
+    matrix_ref(std::vector<cdouble>& src, size_t rows, size_t cols,
+        matrix_layout layout = matrix_layout::row_major, size_t ld = 0) :
+        matrix_ref((uint8_t*) src.data(), rows, cols, layout, ld, sizeof(cdouble), 3)
+    {
+        assert(src.size() >= required());
+    }
+
+    matrix_ref(matrix& src) :
+        matrix_ref(src.data(), src.rows(), src.cols(), src.layout(), 0,
+            strideOf(src.typeIndex()), src.typeIndex())
+    {}
+
+    value_ref operator()(const size_t row, const size_t col)
+    {
+        return value_ref(mData + offset(row, col) * mStride, mIndex);
+    }
+
+    const_value_ref operator()(const size_t row, const size_t col) const
+    {
+        return const_value_ref(mData + offset(row, col) * mStride, mIndex);
+    }
+
+    // Returns the position (in elements) of the given element in memory
+    constexpr size_t offset(const size_t row, const size_t col) const
+    {
+        return row * rowStride() + col * colStride();
+    }
+
+    // Distance (in elements) between vertically adjacent elements
+    constexpr size_t rowStride() const
+    {
+        return mLayout == matrix_layout::row_major ? mLd : 1;
+    }
+
+    // Distance (in elements) between horizontally adjacent elements
+    constexpr size_t colStride() const
+    {
+        return mLayout == matrix_layout::row_major ? 1 : mLd;
+    }
+
+    // Returns a view of the transpose of this matrix. No data is moved; the
+    // layout of the view is simply flipped.
+    matrix_ref transposed() const
+    {
+        const matrix_layout flipped = mLayout == matrix_layout::row_major ?
+            matrix_layout::col_major : matrix_layout::row_major;
+        return matrix_ref(mData, mCols, mRows, flipped, mLd, mStride, mIndex);
+    }
+
+    constexpr size_t rows() const
+    {
+        return mRows;
+    }
+
+    constexpr size_t cols() const
+    {
+        return mCols;
+    }
+
+    constexpr size_t ld() const
+    {
+        return mLd;
+    }
+
+    constexpr matrix_layout layout() const
+    {
+        return mLayout;
+    }
+
+    // Returns a pointer to the first byte of the underlying storage
+    constexpr uint8_t* data() const
+    {
+        return mData;
+    }
+
+    // Returns the index of the currently active type
+    constexpr uint32_t typeIndex() const
+    {
+        return mIndex;
+    }
+
+private:
+    matrix_ref(uint8_t* data, size_t rows, size_t cols, matrix_layout layout,
+        size_t ld, uint32_t stride, uint32_t index) :
+        mData(data),
+        mRows(rows),
+        mCols(cols),
+        mLd(ld != 0 ? ld : (layout == matrix_layout::row_major ? cols : rows)),
+        mStride(stride),
+        mIndex(index),
+        mLayout(layout)
+    {
+        assert(mLd >= (layout == matrix_layout::row_major ? cols : rows));
+    }
+
+    // Returns the number of elements the view spans in memory
+    constexpr size_t required() const
+    {
+        return mRows == 0 || mCols == 0 ? 0 : offset(mRows - 1, mCols - 1) + 1;
+    }
+
+    static uint32_t strideOf(uint32_t index)
+    {
+        return dispatch(index, [](auto tag) { return (uint32_t) sizeof(typename decltype(tag)::type); });
+    }
+
+    uint8_t* mData;
+    size_t mRows;
+    size_t mCols;
+    size_t mLd;
+    uint32_t mStride;
+    uint32_t mIndex;
+    matrix_layout mLayout;
+};
+
+// -------------------------------------------------------------------------- //
+
+// Register block (MR x NR accumulators) and cache block sizes used by gemm().
+// A packed MC x KC block of A stays in L2 while a packed KC x NR sliver of B
+// streams through L1.
+constexpr size_t GEMM_MR = 4;
+constexpr size_t GEMM_NR = 4;
+constexpr size_t GEMM_MC = 64;
+constexpr size_t GEMM_KC = 256;
+constexpr size_t GEMM_NC = 512;
+
+// Number of output rows gemv() accumulates at a time for column-major input
+constexpr size_t GEMV_BLOCK = 256;
+
+// The type an operand of type X is held in while accumulating in Acc. Real
+// operands stay real (only their precision is raised), so a real x complex
+// product costs two multiplications instead of four.
+template <class X, class Acc>
+using operand_t = std::conditional_t<is_complex_v<X>, Acc, real_type_t<Acc>>;
+
+// acc += a * b. Complex x complex products are expanded by hand so they
+// vectorize and avoid the NaN/Inf recovery path of std::complex multiplication.
+template <class Acc, class A, class B>
+inline void multiplyAdd(Acc& acc, const A& a, const B& b)
+{
+    if constexpr (is_complex_v<A> && is_complex_v<B>)
+    {
+        acc = Acc(
+            acc.real() + a.real() * b.real() - a.imag() * b.imag(),
+            acc.imag() + a.real() * b.imag() + a.imag() * b.real()
+        );
+    }
+    else
+        acc += a * b;
+}
+
+// Raw description of a gemm() call, shared by all threads
+struct gemm_args
+{
+    const uint8_t* a;
+    const uint8_t* b;
+    uint8_t* c;
+    size_t m, n, k;
+    size_t aRs, aCs;
+    size_t bRs, bCs;
+    size_t cRs, cCs;
+    value alpha;
+    value beta;
+};
+
+// Packs slivers [s0, s1) of the panel B[pc:pc+kc, jc:jc+nc] into 'packed'.
+// Sliver s holds NR columns and starts at packed + s * NR * kc. Columns past
+// the end of the panel are padded with zeros.
+template <class TB, class PB>
+inline void gemmPackB(const gemm_args& args, PB* FLT_RESTRICT packed,
+    size_t jc, size_t nc, size_t pc, size_t kc, size_t s0, size_t s1)
+{
+    const TB* b = (const TB*) args.b;
+    for (size_t jr = s0 * GEMM_NR; jr < s1 * GEMM_NR; jr += GEMM_NR)
+    {
+        PB* dst = packed + jr * kc;
+        for (size_t p = 0; p < kc; ++p)
+        {
+            for (size_t j = 0; j < GEMM_NR; ++j)
+            {
+                dst[p * GEMM_NR + j] = jr + j < nc ?
+                    PB(b[(pc + p) * args.bRs + (jc + jr + j) * args.bCs]) : PB(0);
+            }
+        }
+    }
+}
+
+// Adds alpha * A[r0:r1, pc:pc+kc] * B[pc:pc+kc, jc:jc+nc] to the same block of
+// C, reading B from the panel packed by gemmPackB(). The first panel of each
+// column block (pc == 0) scales the block of C by beta first.
+template <class TA, class TB, class TC>
+inline void gemmPanel(const gemm_args& args, const operand_t<TB, common_t<TA, TB>>* FLT_RESTRICT pb,
+    size_t jc, size_t nc, size_t pc, size_t kc, size_t r0, size_t r1)
+{
+    using Acc = common_t<TA, TB>;
+    using PA  = operand_t<TA, Acc>;
+    using PB  = operand_t<TB, Acc>;
+    using W   = common_t<Acc, TC>;
+
+    const TA* FLT_RESTRICT a = (const TA*) args.a;
+    TC* FLT_RESTRICT c       = (TC*) args.c;
+    const W alpha = args.alpha.as<W>();
+
+    // C = beta * C. A zero beta overwrites C so NaNs in the output are ignored.
+    if (pc == 0)
+    {
+        const W beta = args.beta.as<W>();
+        for (size_t i = r0; i < r1; ++i)
+        {
+            for (size_t j = jc; j < jc + nc; ++j)
+            {
+                TC& out = c[i * args.cRs + j * args.cCs];
+                out = beta == W(0) ? TC(0) : compat_cast<TC>(beta * compat_cast<W>(out));
+            }
+        }
+    }
+
+    std::vector<PA> packedA(GEMM_KC * ((GEMM_MC + GEMM_MR - 1) / GEMM_MR) * GEMM_MR);
+    for (size_t ic = r0; ic < r1; ic += GEMM_MC)
+    {
+        const size_t mc = std::min(GEMM_MC, r1 - ic);
+
+        // Pack A[ic:ic+mc, pc:pc+kc] into slivers of MR rows
+        for (size_t ir = 0; ir < mc; ir += GEMM_MR)
+        {
+            PA* dst = packedA.data() + ir * kc;
+            for (size_t p = 0; p < kc; ++p)
+            {
+                for (size_t i = 0; i < GEMM_MR; ++i)
+                {
+                    dst[p * GEMM_MR + i] = ir + i < mc ?
+                        PA(a[(ic + ir + i) * args.aRs + (pc + p) * args.aCs]) : PA(0);
+                }
+            }
+        }
+
+        for (size_t jr = 0; jr < nc; jr += GEMM_NR)
+        {
+            for (size_t ir = 0; ir < mc; ir += GEMM_MR)
+            {
+                // Micro-kernel: an MR x NR block of C held in registers
+                const PA* sa = packedA.data() + ir * kc;
+                const PB* sb = pb + jr * kc;
+                Acc acc[GEMM_MR][GEMM_NR] = {};
+                for (size_t p = 0; p < kc; ++p)
+                {
+                    for (size_t i = 0; i < GEMM_MR; ++i)
+                        for (size_t j = 0; j < GEMM_NR; ++j)
+                            multiplyAdd(acc[i][j], sa[p * GEMM_MR + i], sb[p * GEMM_NR + j]);
+                }
+
+                const size_t mr = std::min(GEMM_MR, mc - ir);
+                const size_t nr = std::min(GEMM_NR, nc - jr);
+                for (size_t i = 0; i < mr; ++i)
+                {
+                    for (size_t j = 0; j < nr; ++j)
+                    {
+                        TC& out = c[(ic + ir + i) * args.cRs + (jc + jr + j) * args.cCs];
+                        out = compat_cast<TC>(compat_cast<W>(out) + alpha * W(acc[i][j]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Computes C = alpha * A * B + beta * C with up to 'threads' threads. Each
+// KC x NC panel of B is packed once, split across the threads by sliver, and
+// the read-only copy is then shared by the threads working on the rows of C.
+template <class TA, class TB, class TC>
+void gemmDriver(const gemm_args& args, size_t threads)
+{
+    using Acc = common_t<TA, TB>;
+    using PB  = operand_t<TB, Acc>;
+
+    const auto panel = isa_variants<&gemmPanel<TA, TB, TC>>::select();
+    std::vector<PB> packedB(GEMM_KC * ((GEMM_NC + GEMM_NR - 1) / GEMM_NR) * GEMM_NR);
+
+    // Give every thread at least one full row block
+    const size_t blocks     = (args.m + GEMM_MC - 1) / GEMM_MC;
+    const size_t rowThreads = std::min(threads, blocks);
+
+    for (size_t jc = 0; jc < args.n; jc += GEMM_NC)
+    {
+        const size_t nc      = std::min(GEMM_NC, args.n - jc);
+        const size_t slivers = (nc + GEMM_NR - 1) / GEMM_NR;
+
+        // An empty inner dimension still takes one pass, which applies beta
+        for (size_t pc = 0; pc == 0 || pc < args.k; pc += GEMM_KC)
+        {
+            const size_t kc = std::min(GEMM_KC, args.k - pc);
+            parallel_for(slivers, threads, [&](size_t begin, size_t end, size_t)
+            {
+                gemmPackB<TB>(args, packedB.data(), jc, nc, pc, kc, begin, end);
+            });
+            parallel_for(args.m, rowThreads, [&](size_t begin, size_t end, size_t)
+            {
+                panel(args, packedB.data(), jc, nc, pc, kc, begin, end);
+            });
+        }
+    }
+}
+
+// Computes C = alpha * A * B + beta * C for any combination of element types
+// and layouts. The product is accumulated in the smallest common type of A and
+// B, and real operands are never promoted to complex. The rows of C are split
+// across 'threads' threads. C must not overlap A or B.
+FLT_KERNEL_API void gemm(const matrix_ref& a, const matrix_ref& b, matrix_ref c,
+    value alpha = 1.0f, value beta = 0.0f, size_t threads = defaultThreads());
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void gemm(const matrix_ref& a, const matrix_ref& b, matrix_ref c,
+    value alpha, value beta, size_t threads)
+{
+    assert(a.cols() == b.rows());
+    assert(c.rows() == a.rows() && c.cols() == b.cols());
+
+    const gemm_args args
+    {
+        a.data(), b.data(), c.data(),
+        c.rows(), c.cols(), a.cols(),
+        a.rowStride(), a.colStride(),
+        b.rowStride(), b.colStride(),
+        c.rowStride(), c.colStride(),
+        alpha, beta
+    };
+
+    using driver_fn = void (*)(const gemm_args&, size_t);
+    const driver_fn fn = dispatch(a.typeIndex(), [&](auto ta)
+    {
+        return dispatch(b.typeIndex(), [&](auto tb)
+        {
+            return dispatch(c.typeIndex(), [&](auto tc) -> driver_fn
+            {
+                using TA = typename decltype(ta)::type;
+                using TB = typename decltype(tb)::type;
+                using TC = typename decltype(tc)::type;
+                return &gemmDriver<TA, TB, TC>;
+            });
+        });
+    });
+
+    fn(args, threads);
+}
+#endif
+
+// Computes y = alpha * A * x + beta * y, splitting the rows of A across
+// 'threads' threads. Row-major matrices are processed as a dot product per
+// row. Column-major matrices are processed a block of GEMV_BLOCK rows at a
+// time, so the partial sums stay in L1 while the columns stream past. y must
+// not overlap A or x.
+FLT_KERNEL_API void gemv(const matrix_ref& a, const const_vector_ref& x, vector_ref y,
+    value alpha = 1.0f, value beta = 0.0f, size_t threads = defaultThreads());
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void gemv(const matrix_ref& a, const const_vector_ref& x, vector_ref y,
+    value alpha, value beta, size_t threads)
+{
+    assert(a.cols() == x.size());
+    assert(a.rows() == y.size());
+
+    dispatch(a.typeIndex(), [&](auto ta)
+    {
+        dispatch(x.typeIndex(), [&](auto tx)
+        {
+            dispatch(y.typeIndex(), [&](auto ty)
+            {
+                using TA  = typename decltype(ta)::type;
+                using TX  = typename decltype(tx)::type;
+                using TY  = typename decltype(ty)::type;
+                using Acc = common_t<TA, TX>;
+                using W   = common_t<Acc, TY>;
+                using PA  = operand_t<TA, Acc>;
+                using PX  = operand_t<TX, Acc>;
+
+                const TA* FLT_RESTRICT pa = (const TA*) a.data();
+                const TX* FLT_RESTRICT px = (const TX*) x.data();
+                TY* FLT_RESTRICT py       = (TY*) y.data();
+                const size_t n = a.cols();
+                const size_t rs = a.rowStride();
+                const size_t cs = a.colStride();
+                const W al     = alpha.as<W>();
+                const W be     = beta.as<W>();
+
+                auto write = [&](size_t i, const Acc& sum)
+                {
+                    const W old = be == W(0) ? W(0) : be * compat_cast<W>(py[i]);
+                    py[i]       = compat_cast<TY>(old + al * W(sum));
+                };
+
+                const size_t blocks = (a.rows() + GEMV_BLOCK - 1) / GEMV_BLOCK;
+                parallel_for(a.rows(), std::min(threads, blocks), [&](size_t begin, size_t end, size_t)
+                {
+                    if (cs == 1)
+                    {
+                        for (size_t i = begin; i < end; ++i)
+                        {
+                            const TA* row = pa + i * rs;
+                            Acc sum       = Acc(0);
+                            for (size_t p = 0; p < n; ++p)
+                                multiplyAdd(sum, PA(row[p]), PX(px[p]));
+                            write(i, sum);
+                        }
+                        return;
+                    }
+
+                    std::vector<Acc> sums(GEMV_BLOCK);
+                    for (size_t i0 = begin; i0 < end; i0 += GEMV_BLOCK)
+                    {
+                        const size_t rows = std::min(GEMV_BLOCK, end - i0);
+                        std::fill(sums.begin(), sums.end(), Acc(0));
+                        for (size_t p = 0; p < n; ++p)
+                        {
+                            const TA* col = pa + p * cs + i0 * rs;
+                            const PX xp   = PX(px[p]);
+                            for (size_t i = 0; i < rows; ++i)
+                                multiplyAdd(sums[i], PA(col[i * rs]), xp);
+                        }
+
+                        for (size_t i = 0; i < rows; ++i)
+                            write(i0 + i, sums[i]);
+                    }
+                });
+            });
+        });
+    });
+}
+#endif
+
+// Edge length of the square tiles transpose() works on. Both the source and
+// destination tile fit comfortably in L1.
+constexpr size_t TRANSPOSE_TILE = 32;
+
+// Stores the transpose of 'src' in 'dst', converting the elements to the type
+// of 'dst'. 'dst' must have src.cols() rows and src.rows() columns. Works a
+// tile at a time so neither matrix is walked with a cache-hostile stride. The
+// two matrices must not overlap.
+FLT_KERNEL_API void transpose(const matrix_ref& src, matrix_ref dst, size_t threads = 1);
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void transpose(const matrix_ref& src, matrix_ref dst, size_t threads)
+{
+    assert(dst.rows() == src.cols() && dst.cols() == src.rows());
+
+    dispatch(src.typeIndex(), [&](auto ts)
+    {
+        dispatch(dst.typeIndex(), [&](auto td)
+        {
+            using TS = typename decltype(ts)::type;
+            using TD = typename decltype(td)::type;
+
+            const TS* FLT_RESTRICT in = (const TS*) src.data();
+            TD* FLT_RESTRICT out      = (TD*) dst.data();
+            const size_t srs = src.rowStride(), scs = src.colStride();
+            const size_t drs = dst.rowStride(), dcs = dst.colStride();
+            const size_t rows = src.rows(), cols = src.cols();
+
+            const size_t tiles = (rows + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+            parallel_for(tiles, threads, [&](size_t begin, size_t end, size_t)
+            {
+                for (size_t it = begin; it < end; ++it)
+                {
+                    const size_t i0 = it * TRANSPOSE_TILE;
+                    const size_t i1 = std::min(i0 + TRANSPOSE_TILE, rows);
+                    for (size_t j0 = 0; j0 < cols; j0 += TRANSPOSE_TILE)
+                    {
+                        const size_t j1 = std::min(j0 + TRANSPOSE_TILE, cols);
+                        for (size_t i = i0; i < i1; ++i)
+                            for (size_t j = j0; j < j1; ++j)
+                                out[j * drs + i * dcs] = compat_cast<TD>(in[i * srs + j * scs]);
+                    }
+                }
+            });
+        });
+    });
+}
+#endif
+
+}
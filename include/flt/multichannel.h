@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "flt/complex_types.h"
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/value_ref.h"
+
+namespace flt
+{
+
+// How the samples of a flt::multichannel are arranged in memory.
+//  interleaved - all channels of frame 0, then all channels of frame 1, ...
+//  planar      - all frames of channel 0, then all frames of channel 1, ...
+enum class channel_layout : uint8_t
+{
+    interleaved,
+    planar
+};
+
+// A block of samples for several independent channels that all share the same
+// element type. This is the batched counterpart of flt::vector: kernels that
+// run the same processing on every channel (e.g. flt::multichannel_iir) put
+// the channel dimension in the innermost loop so it can be vectorized, which
+// works even for recursive filters that cannot be vectorized along time.
+class multichannel
+{
+public:
+    multichannel(size_t channels, size_t frames, float val, channel_layout layout = channel_layout::interleaved) :
+        multichannel(channels, frames, sizeof(float), 0, layout)
+    {
+        std::fill((float*) mData, (float*) mData + channels * frames, val);
+    }
+
+    multichannel(size_t channels, size_t frames, double val, channel_layout layout = channel_layout::interleaved) :
+        multichannel(channels, frames, sizeof(double), 1, layout)
+    {
+        std::fill((double*) mData, (double*) mData + channels * frames, val);
+    }
+
+    multichannel(size_t channels, size_t frames, cfloat val, channel_layout layout = channel_layout::interleaved) :
+        multichannel(channels, frames, sizeof(cfloat), 2, layout)
+    {
+        std::fill((cfloat*) mData, (cfloat*) mData + channels * frames, val);
+    }
+
+    multichannel(size_t channels, size_t frames, cdouble val, channel_layout layout = channel_layout::interleaved) :
+        multichannel(channels, frames, sizeof(cdouble), 3, layout)
+    {
+        std::fill((cdouble*) mData, (cdouble*) mData + channels * frames, val);
+    }
+
+    multichannel(const multichannel& other) = delete;
+    multichannel& operator=(const multichannel& other) = delete;
+
+    ~multichannel()
+    {
+        delete[] mData;
+    }
+
+    // Returns the sample of the given channel at the given frame
+    value_ref operator()(const size_t channel, const size_t frame)
+    {
+        return value_ref(mData + offset(channel, frame) * mStride, mIndex);
+    }
+
+    const_value_ref operator()(const size_t channel, const size_t frame) const
+    {
+        return const_value_ref(mData + offset(channel, frame) * mStride, mIndex);
+    }
+
+    // Returns the position (in elements) of the given sample in memory
+    constexpr size_t offset(const size_t channel, const size_t frame) const
+    {
+        return mLayout == channel_layout::interleaved ?
+            frame * mChannels + channel :
+            channel * mFrames + frame;
+    }
+
+    constexpr size_t channels() const
+    {
+        return mChannels;
+    }
+
+    constexpr size_t frames() const
+    {
+        return mFrames;
+    }
+
+    constexpr channel_layout layout() const
+    {
+        return mLayout;
+    }
+
+    // Returns a pointer to the first byte of the underlying storage
+    constexpr uint8_t* data() const
+    {
+        return mData;
+    }
+
+    // Returns the index of the currently active type
+    constexpr uint32_t typeIndex() const
+    {
+        return mIndex;
+    }
+
+private:
+    multichannel(size_t channels, size_t frames, uint32_t stride, uint32_t index, channel_layout layout) :
+        mData(new uint8_t[stride * channels * frames]),
+        mChannels(channels),
+        mFrames(frames),
+        mStride(stride),
+        mIndex(index),
+        mLayout(layout)
+    {}
+
+    uint8_t* mData;
+    size_t mChannels;
+    size_t mFrames;
+    uint32_t mStride;
+    uint32_t mIndex;
+    channel_layout mLayout;
+};
+
+// -------------------------------------------------------------------------- //
+
+// Multiplies every sample of channel c by gains[c]
+FLT_KERNEL_API void gain(multichannel& x, const std::vector<double>& gains);
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void gain(multichannel& x, const std::vector<double>& gains)
+{
+    assert(gains.size() == x.channels());
+    dispatch(x.typeIndex(), [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        using R = real_type_t<T>;
+
+        T* data           = (T*) x.data();
+        const size_t C    = x.channels();
+        const size_t F    = x.frames();
+        std::vector<R> g(gains.begin(), gains.end());
+
+        if (x.layout() == channel_layout::interleaved)
+        {
+            for (size_t f = 0; f < F; ++f)
+            {
+                T* frame = data + f * C;
+                for (size_t c = 0; c < C; ++c)
+                    frame[c] *= g[c];
+            }
+        }
+        else
+        {
+            for (size_t c = 0; c < C; ++c)
+            {
+                T* channel = data + c * F;
+                for (size_t f = 0; f < F; ++f)
+                    channel[f] *= g[c];
+            }
+        }
+    });
+}
+#endif
+
+// Multiplies every sample of every channel by the same gain
+inline void gain(multichannel& x, double g)
+{
+    gain(x, std::vector<double>(x.channels(), g));
+}
+
+// Mixes the channels of 'src' into the channels of 'dst' using the given
+// weights, which are stored as a dst.channels() x src.channels() row-major
+// matrix: dst(m, f) = sum over n of weights[m * src.channels() + n] * src(n, f).
+// Both containers must have the same element type and number of frames.
+FLT_KERNEL_API void mix(const multichannel& src, const std::vector<double>& weights, multichannel& dst);
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void mix(const multichannel& src, const std::vector<double>& weights, multichannel& dst)
+{
+    assert(src.typeIndex() == dst.typeIndex());
+    assert(src.frames() == dst.frames());
+    assert(weights.size() == src.channels() * dst.channels());
+
+    dispatch(src.typeIndex(), [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        using R = real_type_t<T>;
+
+        const size_t N = src.channels();
+        const size_t M = dst.channels();
+        const size_t F = src.frames();
+
+        // Transpose the weights once so that wt[n * M + m] holds the weight
+        // of input n in output m, which makes the inner loop over m contiguous
+        std::vector<R> wt(N * M);
+        for (size_t m = 0; m < M; ++m)
+            for (size_t n = 0; n < N; ++n)
+                wt[n * M + m] = R(weights[m * N + n]);
+
+        const T* in = (const T*) src.data();
+        T* out      = (T*) dst.data();
+        std::vector<T> acc(M);
+        for (size_t f = 0; f < F; ++f)
+        {
+            std::fill(acc.begin(), acc.end(), T(0));
+            for (size_t n = 0; n < N; ++n)
+            {
+                // Broadcast one input sample against a column of the weights
+                const T x    = in[src.offset(n, f)];
+                const R* col = wt.data() + n * M;
+                T* a         = acc.data();
+                for (size_t m = 0; m < M; ++m)
+                    a[m] += col[m] * x;
+            }
+
+            if (dst.layout() == channel_layout::interleaved)
+                std::copy(acc.begin(), acc.end(), out + f * M);
+            else
+            {
+                for (size_t m = 0; m < M; ++m)
+                    out[dst.offset(m, f)] = acc[m];
+            }
+        }
+    });
+}
+#endif
+
+// -------------------------------------------------------------------------- //
+
+// Runs the filter over 'frames' frames of interleaved data in place. 'state'
+// holds 'order' rows of 'channels' delay elements (Direct Form II Transposed),
+// so every inner loop runs across channels over contiguous memory.
+template <class T>
+inline void iirInterleavedLoop(T* data, size_t channels, size_t frames,
+    const real_type_t<T>* b, const real_type_t<T>* a, size_t order, T* state, T* y)
+{
+    const size_t C = channels;
+    for (size_t f = 0; f < frames; ++f)
+    {
+        T* x = data + f * C;
+        if (order == 0)
+        {
+            for (size_t c = 0; c < C; ++c)
+                x[c] *= b[0];
+            continue;
+        }
+
+        for (size_t c = 0; c < C; ++c)
+            y[c] = b[0] * x[c] + state[c];
+
+        for (size_t k = 0; k < order; ++k)
+        {
+            T* z            = state + k * C;
+            const T* next   = state + (k + 1) * C;
+            const auto bk   = b[k + 1];
+            const auto ak   = a[k + 1];
+            if (k + 1 < order)
+            {
+                for (size_t c = 0; c < C; ++c)
+                    z[c] = bk * x[c] - ak * y[c] + next[c];
+            }
+            else
+            {
+                for (size_t c = 0; c < C; ++c)
+                    z[c] = bk * x[c] - ak * y[c];
+            }
+        }
+
+        std::copy(y, y + C, x);
+    }
+}
+
+// Number of frames of a planar container that are transposed into an
+// interleaved scratch buffer at a time by flt::multichannel_iir
+constexpr size_t MULTICHANNEL_TILE_FRAMES = 64;
+
+// An IIR filter applied independently to every channel of a flt::multichannel,
+// with the same coefficients for every channel. Uses the same convention as a
+// direct form implementation:
+//   y[i] = sum_j b[j] * x[i - j] - sum_j a[j] * y[i - j - 1]
+// i.e. 'a' does not include the leading 1. The coefficients are real, and the
+// data may have any of the four element types.
+//
+// The filter state is kept between calls to process(), so a long signal can be
+// filtered one block at a time.
+class multichannel_iir
+{
+public:
+    multichannel_iir(std::vector<double> b, std::vector<double> a, size_t channels) :
+        mChannels(channels),
+        mOrder(std::max(b.size(), a.size() + 1) - 1),
+        mStateType(0)
+    {
+        assert(!b.empty());
+
+        // Store both coefficient sets padded to the same length, with a[0] = 1
+        mB.assign(mOrder + 1, 0.0);
+        mA.assign(mOrder + 1, 0.0);
+        std::copy(b.begin(), b.end(), mB.begin());
+        std::copy(a.begin(), a.end(), mA.begin() + 1);
+        mA[0] = 1.0;
+
+        mState.assign(mOrder * mChannels * sizeof(cdouble), 0);
+    }
+
+    // Clears the filter state
+    void reset()
+    {
+        std::fill(mState.begin(), mState.end(), 0);
+    }
+
+    // Filters every channel of 'x' in place. The state is reset if 'x' does
+    // not have the same element type as the previous call.
+    FLT_KERNEL_API void process(multichannel& x);
+
+    constexpr size_t order() const
+    {
+        return mOrder;
+    }
+
+private:
+    template <class T>
+    void process(multichannel& x)
+    {
+        using R = real_type_t<T>;
+        const auto loop = isa_variants<&iirInterleavedLoop<T>>::select();
+
+        const std::vector<R> b(mB.begin(), mB.end());
+        const std::vector<R> a(mA.begin(), mA.end());
+        const size_t C = mChannels;
+        const size_t F = x.frames();
+        T* state       = (T*) mState.data();
+        T* data        = (T*) x.data();
+        std::vector<T> y(C);
+
+        if (x.layout() == channel_layout::interleaved)
+        {
+            loop(data, C, F, b.data(), a.data(), mOrder, state, y.data());
+            return;
+        }
+
+        // Planar data is transposed a tile at a time so the filter can still
+        // run across channels.
+        std::vector<T> tile(C * MULTICHANNEL_TILE_FRAMES);
+        for (size_t first = 0; first < F; first += MULTICHANNEL_TILE_FRAMES)
+        {
+            const size_t n = std::min(MULTICHANNEL_TILE_FRAMES, F - first);
+            for (size_t c = 0; c < C; ++c)
+                for (size_t f = 0; f < n; ++f)
+                    tile[f * C + c] = data[c * F + first + f];
+
+            loop(tile.data(), C, n, b.data(), a.data(), mOrder, state, y.data());
+
+            for (size_t c = 0; c < C; ++c)
+                for (size_t f = 0; f < n; ++f)
+                    data[c * F + first + f] = tile[f * C + c];
+        }
+    }
+
+    std::vector<double> mB;
+    std::vector<double> mA;
+    std::vector<uint8_t> mState; // Sized for cdouble, the largest element type
+    size_t mChannels;
+    size_t mOrder;
+    uint32_t mStateType;
+};
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void multichannel_iir::process(multichannel& x)
+{
+    assert(x.channels() == mChannels);
+    if (x.typeIndex() != mStateType)
+    {
+        reset();
+        mStateType = x.typeIndex();
+    }
+
+    dispatch(x.typeIndex(), [&](auto tag)
+    {
+        process<typename decltype(tag)::type>(x);
+    });
+}
+#endif
+
+}
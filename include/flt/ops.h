@@ -1,10 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <type_traits>
 
 #include "flt/complex_types.h"
 #include "flt/value_ref.h"
 #include "flt/value.h"
+#include "flt/vector_ref.h"
 #include "flt/compat_cast.h"
 
 namespace flt
@@ -54,7 +57,8 @@ constexpr int typeIndex(T&& val)
     else if constexpr (std::is_same_v<U, cdouble>)
         return 3;
     else if constexpr (
-        std::is_same_v<U, vector_ref>      ||
+        std::is_same_v<U, vector_ref>       ||
+        std::is_same_v<U, const_vector_ref> ||
         // std::is_same_v<U, vector>          ||
         std::is_same_v<U, value_ref>       ||
         std::is_same_v<U, const_value_ref> ||
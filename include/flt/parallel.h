@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace flt
+{
+
+// Returns the number of threads bulk operations use when none is given
+inline size_t defaultThreads()
+{
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+// A half-open range of indices [begin, end)
+struct index_range
+{
+    size_t begin;
+    size_t end;
+};
+
+// Splits [0, n) into 'parts' contiguous ranges whose sizes differ by at most
+// one element and returns range 'index'. Every bulk operation that splits work
+// across threads uses this partitioning, so element i is always handled by
+// the same thread for a given thread count.
+constexpr index_range partition(size_t n, size_t parts, size_t index)
+{
+    const size_t base  = n / parts;
+    const size_t extra = n % parts;
+    const size_t begin = index * base + std::min(index, extra);
+    return { begin, begin + base + (index < extra ? 1 : 0) };
+}
+
+// Calls f(begin, end, index) for each of the 'threads' partitions of [0, n),
+// running them concurrently. Partition 0 runs on the calling thread. Returns
+// once every partition has finished.
+template <class F>
+void parallel_for(size_t n, size_t threads, F&& f)
+{
+    threads = std::max<size_t>(std::min(threads, n), 1);
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t)
+    {
+        const index_range r = partition(n, threads, t);
+        workers.emplace_back([&f, r, t] { f(r.begin, r.end, t); });
+    }
+
+    const index_range r = partition(n, threads, 0);
+    f(r.begin, r.end, (size_t) 0);
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flt/vector_ref.h"
+
+namespace flt
+{
+
+// Default number of bytes handed to the stages of a pipeline at a time. Sized
+// so that a block (plus a little working space) stays resident in a typical
+// per-core L2 cache while it moves from one stage to the next.
+constexpr size_t PIPELINE_BLOCK_BYTES = 128 * 1024;
+
+// Default number of bytes processed at a time by a group of fused element-wise
+// stages. Sized for a typical L1 data cache.
+constexpr size_t PIPELINE_FUSED_BYTES = 16 * 1024;
+
+// Default number of blocks that may wait between two stages before the
+// upstream stage is stalled.
+constexpr size_t PIPELINE_QUEUE_DEPTH = 4;
+
+// Fixed capacity FIFO used to hand blocks from one pipeline stage to the next.
+// push() blocks while the queue is full, which provides backpressure to the
+// producer. pop() blocks while the queue is empty and returns false once the
+// queue has been closed and drained.
+template <class T>
+class bounded_queue
+{
+public:
+    explicit bounded_queue(size_t capacity) :
+        mCapacity(std::max<size_t>(capacity, 1)),
+        mClosed(false)
+    {}
+
+    void push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this] { return mItems.size() < mCapacity; });
+        mItems.push(std::move(item));
+        mNotEmpty.notify_one();
+    }
+
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+        if (mItems.empty())
+            return false;
+
+        item = std::move(mItems.front());
+        mItems.pop();
+        mNotFull.notify_one();
+        return true;
+    }
+
+    // Signals that no more items will be pushed
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotEmpty.notify_all();
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+    std::queue<T> mItems;
+    size_t mCapacity;
+    bool mClosed;
+};
+
+// Per-stage counters collected during pipeline::run()
+struct stage_stats
+{
+    std::string name;
+    size_t blocks   = 0;
+    size_t elements = 0;
+    double seconds  = 0.0;
+
+    // Elements processed per second of time spent inside the stage
+    double throughput() const
+    {
+        return seconds > 0.0 ? elements / seconds : 0.0;
+    }
+};
+
+// Runs a chain of processing stages over a vector in cache-sized blocks.
+// Rather than running each stage over the whole buffer before the next one
+// starts, the data is split into blocks of roughly PIPELINE_BLOCK_BYTES and
+// each block flows through the stages while it is still hot in cache. Stages
+// run concurrently on their own threads and are connected by bounded queues,
+// so a fast stage is stalled once it gets too far ahead of a slow one.
+//
+// Stages receive a flt::vector_ref that views one block of the input along with
+// the offset of that block's first element, so stages that write to another
+// buffer (e.g. a conversion or a reduction) know where the block belongs.
+//
+// Adjacent stages added with add_elementwise() are fused: they share a single
+// thread and are applied one after another over L1-sized pieces of each block,
+// so the data makes a single trip through the cache for the whole group.
+//
+// Example:
+//   flt::pipeline p;
+//   p.add_elementwise("scale", [](flt::vector_ref b, size_t) { ... });
+//   p.add_elementwise("clip",  [](flt::vector_ref b, size_t) { ... });
+//   p.add("fft", [&](flt::vector_ref b, size_t offset) { ... });
+//   p.run(flt::vector_ref(samples));
+class pipeline
+{
+public:
+    using stage_fn = std::function<void(vector_ref, size_t)>;
+
+    explicit pipeline(
+        size_t blockBytes = PIPELINE_BLOCK_BYTES,
+        size_t queueDepth = PIPELINE_QUEUE_DEPTH,
+        size_t fusedBytes = PIPELINE_FUSED_BYTES
+    ) :
+        mBlockBytes(std::max<size_t>(blockBytes, 1)),
+        mQueueDepth(queueDepth),
+        mFusedBytes(std::max<size_t>(fusedBytes, 1))
+    {}
+
+    // Adds a stage that runs on its own thread and sees whole blocks
+    pipeline& add(std::string name, stage_fn fn)
+    {
+        mStages.push_back({std::move(name), std::move(fn), false});
+        return *this;
+    }
+
+    // Adds a stage that only depends on the element(s) at each position.
+    // Consecutive element-wise stages are fused into a single pass.
+    pipeline& add_elementwise(std::string name, stage_fn fn)
+    {
+        mStages.push_back({std::move(name), std::move(fn), true});
+        return *this;
+    }
+
+    // Pushes every block of 'data' through all of the stages. Returns once the
+    // last stage has finished with the last block. If a stage throws, the
+    // remaining blocks are drained without further processing and the first
+    // exception is rethrown here.
+    void run(vector_ref data)
+    {
+        mStats.assign(mStages.size(), stage_stats());
+        for (size_t i = 0; i < mStages.size(); ++i)
+            mStats[i].name = mStages[i].name;
+        if (mStages.empty() || data.size() == 0)
+            return;
+
+        const std::vector<group> groups = makeGroups();
+        const size_t blockElements      = std::max<size_t>(mBlockBytes / data.stride(), 1);
+        const size_t fusedElements      = std::max<size_t>(mFusedBytes / data.stride(), 1);
+
+        // queues[i] feeds groups[i]
+        std::vector<std::unique_ptr<bounded_queue<size_t>>> queues;
+        for (size_t i = 0; i < groups.size(); ++i)
+            queues.push_back(std::make_unique<bounded_queue<size_t>>(mQueueDepth));
+
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        auto fail = [&](std::exception_ptr e)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = e;
+        };
+        auto failed = [&]
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            return (bool) error;
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t g = 0; g < groups.size(); ++g)
+        {
+            workers.emplace_back([&, g]
+            {
+                const group& grp = groups[g];
+                size_t offset;
+                while (queues[g]->pop(offset))
+                {
+                    if (!failed())
+                    {
+                        vector_ref block = data.slice(offset,
+                            std::min(blockElements, data.size() - offset));
+
+                        try
+                        {
+                            if (grp.fused)
+                                runFused(grp, block, offset, fusedElements);
+                            else
+                            {
+                                runStage(grp.first, block, offset);
+                                ++mStats[grp.first].blocks;
+                            }
+                        }
+                        catch (...)
+                        {
+                            fail(std::current_exception());
+                        }
+                    }
+
+                    if (g + 1 < groups.size())
+                        queues[g + 1]->push(offset);
+                }
+
+                if (g + 1 < groups.size())
+                    queues[g + 1]->close();
+            });
+        }
+
+        for (size_t offset = 0; offset < data.size(); offset += blockElements)
+            queues[0]->push(offset);
+        queues[0]->close();
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Returns the counters collected during the most recent call to run(), in
+    // the order the stages were added.
+    const std::vector<stage_stats>& stats() const
+    {
+        return mStats;
+    }
+
+    // Returns the number of threads run() will use, which is the number of
+    // stages once adjacent element-wise stages have been fused.
+    size_t threads() const
+    {
+        return makeGroups().size();
+    }
+
+private:
+    struct stage
+    {
+        std::string name;
+        stage_fn fn;
+        bool elementwise;
+    };
+
+    // A contiguous range of stages [first, last) that share one thread
+    struct group
+    {
+        size_t first;
+        size_t last;
+        bool fused;
+    };
+
+    std::vector<group> makeGroups() const
+    {
+        std::vector<group> groups;
+        for (size_t i = 0; i < mStages.size(); ++i)
+        {
+            if (mStages[i].elementwise && !groups.empty() && groups.back().fused)
+                groups.back().last = i + 1;
+            else
+                groups.push_back({i, i + 1, mStages[i].elementwise});
+        }
+        return groups;
+    }
+
+    void runStage(size_t index, vector_ref block, size_t offset)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        mStages[index].fn(block, offset);
+        const auto end = std::chrono::steady_clock::now();
+
+        stage_stats& stats = mStats[index];
+        stats.seconds  += std::chrono::duration<double>(end - start).count();
+        stats.elements += block.size();
+    }
+
+    // Applies each stage of the group to one L1-sized piece of the block
+    // before moving on to the next piece.
+    void runFused(const group& grp, vector_ref block, size_t offset, size_t pieceElements)
+    {
+        for (size_t first = 0; first < block.size(); first += pieceElements)
+        {
+            const size_t count = std::min(pieceElements, block.size() - first);
+            for (size_t i = grp.first; i < grp.last; ++i)
+                runStage(i, block.slice(first, count), offset + first);
+        }
+
+        for (size_t i = grp.first; i < grp.last; ++i)
+            ++mStats[i].blocks;
+    }
+
+    std::vector<stage> mStages;
+    std::vector<stage_stats> mStats;
+    size_t mBlockBytes;
+    size_t mQueueDepth;
+    size_t mFusedBytes;
+};
+
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/parallel.h"
+#include "flt/value.h"
+#include "flt/vector_ref.h"
+
+namespace flt
+{
+
+// The distributions philox can fill a vector with
+enum class distribution : uint8_t
+{
+    uniform,
+    normal
+};
+
+// Number of counter blocks generated together by the fill loops. Large enough
+// for the rounds to be vectorized across blocks.
+constexpr size_t PHILOX_BATCH = 64;
+
+// Parameters of a fill, already converted to the real type R being generated
+template <class R>
+struct fill_params
+{
+    distribution dist;
+    R a;      // lower bound, or the mean of the real part
+    R b;      // upper bound, or the mean of the imaginary part
+    R scale;  // (hi - lo), or the standard deviation of each part
+};
+
+// One Philox4x32-10 evaluation on (c0, c1, c2, c3) with key (k0, k1)
+inline void philoxRounds(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, uint32_t k0, uint32_t k1)
+{
+    for (int r = 0; r < 10; ++r)
+    {
+        const uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+        const uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+        const uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+        const uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+        c1 = uint32_t(p1);
+        c3 = uint32_t(p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+}
+
+// Writes the scalars with stream positions [first, first + count) to 'out'.
+// Each counter block supplies 4 floats or 2 doubles, so the value at any
+// position depends only on the key, the stream and the position itself.
+template <class R>
+inline void philoxFillLoop(R* out, uint64_t first, size_t count,
+    uint32_t k0, uint32_t k1, uint64_t stream, const fill_params<R>& params)
+{
+    constexpr size_t PER_BLOCK = std::is_same_v<R, float> ? 4 : 2;
+    constexpr R TWO_PI         = R(6.283185307179586476925286766559);
+
+    uint32_t w[4][PHILOX_BATCH];
+    R values[PHILOX_BATCH * PER_BLOCK];
+
+    const uint64_t end = first + count;
+    uint64_t block     = first / PER_BLOCK;
+    while (block * PER_BLOCK < end)
+    {
+        // Generate a batch of counter blocks. Each iteration is independent,
+        // so this loop vectorizes across blocks, with the vector width of
+        // whichever isa_variants instantiation it is inlined into.
+        for (size_t j = 0; j < PHILOX_BATCH; ++j)
+        {
+            const uint64_t ctr = block + j;
+            uint32_t c0 = uint32_t(ctr), c1 = uint32_t(ctr >> 32);
+            uint32_t c2 = uint32_t(stream), c3 = uint32_t(stream >> 32);
+            philoxRounds(c0, c1, c2, c3, k0, k1);
+            w[0][j] = c0; w[1][j] = c1; w[2][j] = c2; w[3][j] = c3;
+        }
+
+        // Turn the random bits into uniforms in [0, 1). Box-Muller needs its
+        // first uniform in (0, 1], which is 1 - u.
+        for (size_t j = 0; j < PHILOX_BATCH; ++j)
+        {
+            R u[PER_BLOCK];
+            if constexpr (PER_BLOCK == 4)
+            {
+                for (size_t l = 0; l < 4; ++l)
+                    u[l] = R(w[l][j] >> 8) * R(1.0 / 16777216.0);
+            }
+            else
+            {
+                for (size_t l = 0; l < 2; ++l)
+                {
+                    const uint64_t bits = (uint64_t(w[2 * l][j]) << 32) | w[2 * l + 1][j];
+                    u[l] = R(bits >> 11) * R(1.0 / 9007199254740992.0);
+                }
+            }
+
+            R* v = values + j * PER_BLOCK;
+            if (params.dist == distribution::uniform)
+            {
+                for (size_t l = 0; l < PER_BLOCK; ++l)
+                    v[l] = params.a + params.scale * u[l];
+            }
+            else
+            {
+                for (size_t l = 0; l < PER_BLOCK; l += 2)
+                {
+                    const R radius = params.scale * std::sqrt(R(-2) * std::log(R(1) - u[l]));
+                    const R theta  = TWO_PI * u[l + 1];
+                    v[l]     = params.a + radius * std::cos(theta);
+                    v[l + 1] = params.b + radius * std::sin(theta);
+                }
+            }
+        }
+
+        // Copy out the part of the batch that falls inside [first, end)
+        const uint64_t batchFirst = block * PER_BLOCK;
+        const uint64_t lo         = std::max(first, batchFirst);
+        const uint64_t hi         = std::min(end, batchFirst + PHILOX_BATCH * PER_BLOCK);
+        std::copy(values + (lo - batchFirst), values + (hi - batchFirst), out + (lo - first));
+        block += PHILOX_BATCH;
+    }
+}
+
+// Counter-based random number generator (Philox4x32-10) that fills whole
+// vectors. Every element is a pure function of (seed, stream, position), so
+// a fill can be split across any number of threads and still produce exactly
+// the same values, and separate streams never overlap.
+//
+// Complex vectors get independent real and imaginary parts. normal() on a
+// complex vector produces a circularly-symmetric complex normal: each part has
+// variance stddev^2 / 2, so E|z - mean|^2 = stddev^2.
+//
+// 'offset' is the position (in elements) of the first element within the
+// stream, so a long sequence can be produced one block at a time:
+//   flt::philox rng(42);
+//   rng.normal(block, 0.0, 1.0, 0);
+//   rng.normal(block, 0.0, 1.0, block.size());
+class philox
+{
+public:
+    explicit philox(uint64_t seed, uint64_t stream = 0) :
+        mKey0(uint32_t(seed)),
+        mKey1(uint32_t(seed >> 32)),
+        mStream(stream)
+    {}
+
+    // Fills 'out' with values drawn uniformly from [lo, hi)
+    void uniform(vector_ref out, double lo = 0.0, double hi = 1.0,
+        uint64_t offset = 0, size_t threads = defaultThreads()) const
+    {
+        fill(out, distribution::uniform, value(lo), hi - lo, offset, threads);
+    }
+
+    // Fills 'out' with normally distributed values
+    void normal(vector_ref out, value mean = 0.0, double stddev = 1.0,
+        uint64_t offset = 0, size_t threads = defaultThreads()) const
+    {
+        fill(out, distribution::normal, mean, stddev, offset, threads);
+    }
+
+    // Evaluates the underlying bijection for one counter. Exposed so the
+    // generator can be checked against published known-answer vectors.
+    static std::array<uint32_t, 4> block(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key)
+    {
+        philoxRounds(counter[0], counter[1], counter[2], counter[3], key[0], key[1]);
+        return counter;
+    }
+
+private:
+    FLT_KERNEL_API void fill(vector_ref out, distribution dist, value a, double scale, uint64_t offset, size_t threads) const;
+
+    uint32_t mKey0;
+    uint32_t mKey1;
+    uint64_t mStream;
+};
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API void philox::fill(vector_ref out, distribution dist, value a, double scale, uint64_t offset, size_t threads) const
+{
+    dispatch(out.typeIndex(), [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        using R = real_type_t<T>;
+        constexpr size_t PARTS = is_complex_v<T> ? 2 : 1;
+
+        const auto fn = isa_variants<&philoxFillLoop<R>>::select();
+
+        fill_params<R> params;
+        params.dist = dist;
+        if (dist == distribution::uniform)
+        {
+            params.a     = R(a.as<double>());
+            params.b     = params.a;
+            params.scale = R(scale);
+        }
+        else
+        {
+            const cdouble mean = a.as<cdouble>();
+            params.a     = R(mean.real());
+            params.b     = PARTS == 2 ? R(mean.imag()) : params.a;
+            params.scale = PARTS == 2 ? R(scale / std::sqrt(2.0)) : R(scale);
+        }
+
+        // Partitions are in elements, but the stream is indexed by scalar
+        // (two per complex element), which keeps real and imaginary parts
+        // independent and the values independent of the thread count.
+        R* data = (R*) out.data();
+        parallel_for(out.size(), threads, [&](size_t begin, size_t end, size_t)
+        {
+            fn(data + begin * PARTS, (offset + begin) * PARTS, (end - begin) * PARTS,
+                mKey0, mKey1, mStream, params);
+        });
+    });
+}
+#endif
+
+}
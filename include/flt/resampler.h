@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "flt/dispatch.h"
+#include "flt/isa.h"
+#include "flt/kernel_api.h"
+#include "flt/vector_ref.h"
+
+namespace flt
+{
+
+// Number of partial sums each output of a flt::resampler is accumulated in.
+// Every phase of the filter bank is zero padded to a multiple of this many
+// taps, so the dot product loops have no remainder and vectorize cleanly.
+constexpr size_t RESAMPLER_LANES = 16;
+
+// Computes 'outputs' consecutive outputs of a polyphase filter. Output m uses
+// upsampled time t = time + m * down: phase t % up of the bank is applied to
+// the window of inputs that starts at element t / up of 'in'. Complex samples
+// (PARTS == 2) are processed as interleaved reals against a bank in which
+// every tap is duplicated, so the same loop serves both kinds of signal.
+template <class R, size_t PARTS>
+inline void resampleLoop(const R* FLT_RESTRICT in, R* FLT_RESTRICT out, size_t outputs,
+    const R* FLT_RESTRICT bank, size_t length, size_t up, size_t down, size_t time)
+{
+    for (size_t m = 0; m < outputs; ++m, time += down)
+    {
+        const R* taps = bank + (time % up) * length;
+        const R* x    = in + (time / up) * PARTS;
+
+        R acc[RESAMPLER_LANES] = {};
+        for (size_t i = 0; i < length; i += RESAMPLER_LANES)
+        {
+            for (size_t j = 0; j < RESAMPLER_LANES; ++j)
+                acc[j] += taps[i + j] * x[i + j];
+        }
+
+        for (size_t p = 0; p < PARTS; ++p)
+        {
+            R sum = R(0);
+            for (size_t j = p; j < RESAMPLER_LANES; j += PARTS)
+                sum += acc[j];
+            out[m * PARTS + p] = sum;
+        }
+    }
+}
+
+// Rational sample rate converter. Conceptually, the input is upsampled by
+// 'up' (inserting up - 1 zeros after every sample), filtered with 'taps', and
+// then decimated by 'down':
+//   y[m] = sum_k taps[k] * u[m * down - k],  u[n * up] = x[n], 0 elsewhere
+// The filter is split into 'up' polyphase branches, so only the outputs that
+// are kept are computed and the inserted zeros are never multiplied. up = 1
+// gives a plain decimating FIR filter.
+//
+// The taps are real and are not normalized; an interpolating filter usually
+// needs a DC gain of 'up'. The signal may have any of the four element types.
+// The filter state is kept between calls to process(), so a long signal can be
+// resampled one block at a time with the same result as a single call.
+//
+// Example:
+//   flt::resampler r(3, 2, taps);  // 1.5x the input rate
+//   std::vector<float> y(r.outputSize(x.size()));
+//   r.process(flt::vector_ref(x), flt::vector_ref(y));
+class resampler
+{
+public:
+    resampler(size_t up, size_t down, const std::vector<double>& taps) :
+        mTime(0),
+        mStateType(0)
+    {
+        assert(up > 0 && down > 0 && !taps.empty());
+        const size_t g = std::gcd(up, down);
+        mUp            = up / g;
+        mDown          = down / g;
+
+        // Phase p holds taps p, p + up, p + 2 * up, ... in reverse order, so it
+        // can be applied as a forward dot product with the input window. The
+        // front is zero padded up to a multiple of RESAMPLER_LANES.
+        const size_t branch = (taps.size() + mUp - 1) / mUp;
+        mLength             = (branch + RESAMPLER_LANES - 1) / RESAMPLER_LANES * RESAMPLER_LANES;
+        mBank.assign(mUp * mLength, 0.0);
+        for (size_t p = 0; p < mUp; ++p)
+        {
+            for (size_t j = 0; j < branch && p + j * mUp < taps.size(); ++j)
+                mBank[p * mLength + mLength - 1 - j] = taps[p + j * mUp];
+        }
+
+        mBankFloat   = expand<float>(1);
+        mBankDouble  = expand<double>(1);
+        mBankCfloat  = expand<float>(2);
+        mBankCdouble = expand<double>(2);
+
+        mHistory.assign(history() * sizeof(cdouble), 0);
+    }
+
+    // Clears the filter state
+    void reset()
+    {
+        std::fill(mHistory.begin(), mHistory.end(), 0);
+        mTime = 0;
+    }
+
+    // Returns the number of outputs the next call to process() will produce
+    // for an input of the given length
+    size_t outputSize(size_t inputSize) const
+    {
+        const size_t end = inputSize * mUp;
+        return mTime < end ? (end - mTime + mDown - 1) / mDown : 0;
+    }
+
+    // Resamples 'in', writing outputSize(in.size()) values to the front of
+    // 'out', and returns that number. Both must have the same element type.
+    // The state is reset if the type differs from the previous call.
+    FLT_KERNEL_API size_t process(const const_vector_ref& in, vector_ref out);
+
+    constexpr size_t up() const
+    {
+        return mUp;
+    }
+
+    constexpr size_t down() const
+    {
+        return mDown;
+    }
+
+    // Returns the number of taps in each polyphase branch (after padding)
+    constexpr size_t length() const
+    {
+        return mLength;
+    }
+
+private:
+    // Number of past input samples each output window reaches back
+    size_t history() const
+    {
+        return mLength - 1;
+    }
+
+    // Converts the bank to R, duplicating every tap for complex signals
+    template <class R>
+    std::vector<R> expand(size_t parts) const
+    {
+        std::vector<R> bank(mBank.size() * parts);
+        for (size_t i = 0; i < mBank.size(); ++i)
+            for (size_t p = 0; p < parts; ++p)
+                bank[i * parts + p] = R(mBank[i]);
+        return bank;
+    }
+
+    template <class R, size_t PARTS>
+    const std::vector<R>& bank() const
+    {
+        if constexpr (std::is_same_v<R, float>)
+            return PARTS == 1 ? mBankFloat : mBankCfloat;
+        else
+            return PARTS == 1 ? mBankDouble : mBankCdouble;
+    }
+
+    template <class R, size_t PARTS>
+    void process(const const_vector_ref& in, vector_ref out, size_t outputs)
+    {
+        const auto loop = isa_variants<&resampleLoop<R, PARTS>>::select();
+
+        const R* taps    = bank<R, PARTS>().data();
+        const size_t L   = mLength * PARTS;
+        const size_t H   = history();
+        const size_t N   = in.size();
+        const R* x       = (const R*) in.data();
+        R* y             = (R*) out.data();
+        R* past          = (R*) mHistory.data();
+
+        // Outputs whose window starts before the first new sample also need the
+        // history. They are computed from a small staging buffer holding the
+        // history followed by the first H new samples. Every later output
+        // reads the input directly.
+        const size_t head = std::min(outputs, H * mUp > mTime ? (H * mUp - mTime + mDown - 1) / mDown : 0);
+        if (head > 0)
+        {
+            std::vector<R> staging(2 * H * PARTS, R(0));
+            std::copy(past, past + H * PARTS, staging.begin());
+            std::copy(x, x + std::min(N, H) * PARTS, staging.begin() + H * PARTS);
+            loop(staging.data(), y, head, taps, L, mUp, mDown, mTime);
+        }
+
+        // The window for upsampled time t starts at input t / up - H
+        const size_t shift = H * mUp;
+        loop(x, y + head * PARTS, outputs - head, taps, L, mUp, mDown, mTime + head * mDown - shift);
+
+        // Keep the last H samples of history + input for the next call
+        if (N >= H)
+            std::copy(x + (N - H) * PARTS, x + N * PARTS, past);
+        else
+        {
+            std::copy(past + N * PARTS, past + H * PARTS, past);
+            std::copy(x, x + N * PARTS, past + (H - N) * PARTS);
+        }
+
+        mTime = mTime + outputs * mDown - N * mUp;
+    }
+
+    std::vector<double> mBank; // mUp rows of mLength taps
+    std::vector<float> mBankFloat;
+    std::vector<double> mBankDouble;
+    std::vector<float> mBankCfloat;
+    std::vector<double> mBankCdouble;
+    std::vector<uint8_t> mHistory; // Sized for cdouble, the largest element type
+    size_t mUp;
+    size_t mDown;
+    size_t mLength;
+    size_t mTime;  // Upsampled time of the next output, relative to the next input
+    uint32_t mStateType;
+};
+
+#if FLT_KERNEL_DEFINITIONS
+FLT_KERNEL_API size_t resampler::process(const const_vector_ref& in, vector_ref out)
+{
+    assert(in.typeIndex() == out.typeIndex());
+    if (in.typeIndex() != mStateType)
+    {
+        reset();
+        mStateType = in.typeIndex();
+    }
+
+    const size_t outputs = outputSize(in.size());
+    assert(out.size() >= outputs);
+
+    dispatch(in.typeIndex(), [&](auto tag)
+    {
+        using T = typename decltype(tag)::type;
+        if constexpr (is_complex_v<T>)
+            process<real_type_t<T>, 2>(in, out, outputs);
+        else
+            process<T, 1>(in, out, outputs);
+    });
+    return outputs;
+}
+#endif
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "flt/complex_types.h"
+#include <cstdint>
 #include <cstring>
 
 namespace flt
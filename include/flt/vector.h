@@ -1,54 +1,82 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdlib>
+#include <new>
 #include "flt/complex_types.h"
+#include "flt/parallel.h"
 #include "flt/value_ref.h"
 
+#if defined(__linux__)
+    #include <sys/mman.h>
+#endif
+
 namespace flt
 {
 
+// Alignment of every flt::vector allocation (one cache line)
+constexpr size_t VECTOR_ALIGNMENT = 64;
+
+// Size of a transparent huge page on x86-64 and most AArch64 kernels
+constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+// Vectors at least this large are allocated and initialized according to the
+// allocation_policy. Smaller ones are filled on the calling thread, where the
+// cost of starting threads would outweigh the fill.
+constexpr size_t VECTOR_LARGE_BYTES = 32 * 1024 * 1024;
+
+// How flt::vector allocates and initializes large buffers.
+//
+// 'threads' should match the number of threads the vector is later processed
+// with. The initial fill uses the same partition() of the elements that the
+// bulk operations use, so with first-touch NUMA placement every page ends up
+// on the node of the thread that will work on it.
+//
+// With 'hugePages', the buffer is aligned to HUGE_PAGE_BYTES and marked with
+// madvise(MADV_HUGEPAGE), so the kernel backs it with transparent huge pages
+// when it can. This is advisory; the allocation still succeeds without it.
+struct allocation_policy
+{
+    size_t threads    = defaultThreads();
+    bool hugePages    = true;
+    size_t largeBytes = VECTOR_LARGE_BYTES;
+};
+
 class vector
 {
 public:
-    vector(size_t size, float val) :
-        mData(new uint8_t[sizeof(float) * size]),
-        mSize(size),
-        mStride(sizeof(float)),
-        mIndex(0)
-    {
-        std::fill((float*) mData, (float*) mData + size, val);
-    }
+    vector(size_t size, float val, const allocation_policy& policy = allocation_policy()) :
+        vector(size, val, 0, policy)
+    {}
 
-    vector(size_t size, double val) :
-        mData(new uint8_t[sizeof(double) * size]),
-        mSize(size),
-        mStride(sizeof(double)),
-        mIndex(1)
-    {
-        std::fill((double*) mData, (double*) mData + size, val);
-    }
+    vector(size_t size, double val, const allocation_policy& policy = allocation_policy()) :
+        vector(size, val, 1, policy)
+    {}
 
-    vector(size_t size, cfloat val) :
-        mData(new uint8_t[sizeof(cfloat) * size]),
-        mSize(size),
-        mStride(sizeof(cfloat)),
-        mIndex(2)
-    {
-        std::fill((cfloat*) mData, (cfloat*) mData + size, val);
-    }
+    vector(size_t size, cfloat val, const allocation_policy& policy = allocation_policy()) :
+        vector(size, val, 2, policy)
+    {}
 
-    vector(size_t size, cdouble val) :
-        mData(new uint8_t[sizeof(cdouble) * size]),
-        mSize(size),
-        mStride(sizeof(cdouble)),
-        mIndex(3)
+    vector(size_t size, cdouble val, const allocation_policy& policy = allocation_policy()) :
+        vector(size, val, 3, policy)
+    {}
+
+    vector(vector&& other) noexcept :
+        mData(other.mData),
+        mSize(other.mSize),
+        mStride(other.mStride),
+        mIndex(other.mIndex)
     {
-        std::fill((cdouble*) mData, (cdouble*) mData + size, val);
+        other.mData = nullptr;
+        other.mSize = 0;
     }
 
+    vector(const vector& other) = delete;
+    vector& operator=(const vector& other) = delete;
+
     ~vector()
     {
-        delete[] mData;
+        std::free(mData);
     }
 
     constexpr value_ref operator[](const size_t index)
@@ -66,6 +94,23 @@ public:
         return mSize;
     }
 
+    // Returns a pointer to the first byte of the underlying storage
+    uint8_t* data()
+    {
+        return mData;
+    }
+
+    const uint8_t* data() const
+    {
+        return mData;
+    }
+
+    // Returns the number of bytes occupied by each element
+    constexpr uint32_t stride() const
+    {
+        return mStride;
+    }
+
     // Returns the index of the currently active type
     constexpr uint32_t typeIndex() const
     {
@@ -73,6 +118,69 @@ public:
     }
 
 private:
+    // Allocates the buffer and fills it with 'val'. fill() may throw (e.g. if a
+    // thread cannot be started), and the destructor does not run for an object
+    // whose constructor throws, so the buffer is released here in that case.
+    template <class T>
+    vector(size_t size, T val, uint32_t index, const allocation_policy& policy) :
+        mData(nullptr),
+        mSize(size),
+        mStride(sizeof(T)),
+        mIndex(index)
+    {
+        allocate(policy);
+        try
+        {
+            fill(val, policy);
+        }
+        catch (...)
+        {
+            std::free(mData);
+            throw;
+        }
+    }
+
+    void allocate(const allocation_policy& policy)
+    {
+        const size_t bytes     = std::max<size_t>(mSize * mStride, 1);
+        const bool huge        = policy.hugePages && isLarge(policy);
+        const size_t alignment = huge ? HUGE_PAGE_BYTES : VECTOR_ALIGNMENT;
+        const size_t rounded   = (bytes + alignment - 1) / alignment * alignment;
+
+        mData = (uint8_t*) std::aligned_alloc(alignment, rounded);
+        if (mData == nullptr)
+            throw std::bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge)
+            madvise(mData, rounded, MADV_HUGEPAGE);
+#endif
+    }
+
+    bool isLarge(const allocation_policy& policy) const
+    {
+        return mSize * mStride >= policy.largeBytes;
+    }
+
+    // Writes 'val' to every element. This is the first touch of the memory,
+    // so for large vectors it is split across threads the same way the
+    // vector will be processed.
+    template <class T>
+    void fill(T val, const allocation_policy& policy)
+    {
+        T* data = (T*) mData;
+        if (!isLarge(policy))
+        {
+            std::fill(data, data + mSize, val);
+            return;
+        }
+
+        parallel_for(mSize, policy.threads, [&](size_t begin, size_t end, size_t)
+        {
+            std::fill(data + begin, data + end, val);
+        });
+    }
+
     uint8_t* mData;
     size_t mSize;
     uint32_t mStride;
@@ -2,6 +2,11 @@
 
 #include <vector>
 #include "flt/value_ref.h"
+#include "flt/vector.h"
+
+#if __cplusplus >= 202002L
+    #include <span>
+#endif
 
 namespace flt
 {
@@ -37,6 +42,27 @@ public:
         mIndex(3)
     {}
 
+    // Views over memory that is not owned by a std::vector (e.g. a DMA buffer,
+    // a std::array, or memory handed out by a C API)
+    vector_ref(float* data, size_t size)   : vector_ref((uint8_t*) data, size, sizeof(float),   0) {}
+    vector_ref(double* data, size_t size)  : vector_ref((uint8_t*) data, size, sizeof(double),  1) {}
+    vector_ref(cfloat* data, size_t size)  : vector_ref((uint8_t*) data, size, sizeof(cfloat),  2) {}
+    vector_ref(cdouble* data, size_t size) : vector_ref((uint8_t*) data, size, sizeof(cdouble), 3) {}
+
+#if __cplusplus >= 202002L
+    vector_ref(std::span<float> src)   : vector_ref(src.data(), src.size()) {}
+    vector_ref(std::span<double> src)  : vector_ref(src.data(), src.size()) {}
+    vector_ref(std::span<cfloat> src)  : vector_ref(src.data(), src.size()) {}
+    vector_ref(std::span<cdouble> src) : vector_ref(src.data(), src.size()) {}
+#endif
+
+    vector_ref(vector& src) :
+        mData(src.data()),
+        mSize(src.size()),
+        mStride(src.stride()),
+        mIndex(src.typeIndex())
+    {}
+
     value_ref operator[](const size_t index)
     {
         return value_ref(mData + index * mStride, mIndex);
@@ -51,7 +77,26 @@ public:
     {
         return mSize;
     }
-    
+
+    // Returns a pointer to the first byte of the underlying storage
+    constexpr uint8_t* data() const
+    {
+        return mData;
+    }
+
+    // Returns the number of bytes occupied by each element
+    constexpr uint32_t stride() const
+    {
+        return mStride;
+    }
+
+    // Returns a view of 'count' elements starting at element 'first'. The
+    // slice shares memory with this object (and with the original container).
+    vector_ref slice(const size_t first, const size_t count) const
+    {
+        return vector_ref(mData + first * mStride, count, mStride, mIndex);
+    }
+
     // Returns the index of the currently active type
     constexpr uint32_t typeIndex() const
     {
@@ -59,10 +104,99 @@ public:
     }
 
 private:
+    friend class const_vector_ref;
+
+    vector_ref(uint8_t* data, size_t size, uint32_t stride, uint32_t index) :
+        mData(data),
+        mSize(size),
+        mStride(stride),
+        mIndex(index)
+    {}
+
     uint8_t* mData;
     size_t mSize;
     uint32_t mStride;
     uint32_t mIndex;
 };
 
+// Read-only counterpart of flt::vector_ref. Can be created from const
+// containers and const memory, and every flt::vector_ref converts to one
+// implicitly, so functions that only read an operand should take a
+// const_vector_ref.
+class const_vector_ref
+{
+public:
+    const_vector_ref(const std::vector<float>& src)   : const_vector_ref(src.data(), src.size()) {}
+    const_vector_ref(const std::vector<double>& src)  : const_vector_ref(src.data(), src.size()) {}
+    const_vector_ref(const std::vector<cfloat>& src)  : const_vector_ref(src.data(), src.size()) {}
+    const_vector_ref(const std::vector<cdouble>& src) : const_vector_ref(src.data(), src.size()) {}
+
+    const_vector_ref(const float* data, size_t size)   : const_vector_ref((const uint8_t*) data, size, sizeof(float),   0) {}
+    const_vector_ref(const double* data, size_t size)  : const_vector_ref((const uint8_t*) data, size, sizeof(double),  1) {}
+    const_vector_ref(const cfloat* data, size_t size)  : const_vector_ref((const uint8_t*) data, size, sizeof(cfloat),  2) {}
+    const_vector_ref(const cdouble* data, size_t size) : const_vector_ref((const uint8_t*) data, size, sizeof(cdouble), 3) {}
+
+#if __cplusplus >= 202002L
+    const_vector_ref(std::span<const float> src)   : const_vector_ref(src.data(), src.size()) {}
+    const_vector_ref(std::span<const double> src)  : const_vector_ref(src.data(), src.size()) {}
+    const_vector_ref(std::span<const cfloat> src)  : const_vector_ref(src.data(), src.size()) {}
+    const_vector_ref(std::span<const cdouble> src) : const_vector_ref(src.data(), src.size()) {}
+#endif
+
+    const_vector_ref(const vector& src) :
+        const_vector_ref(src.data(), src.size(), src.stride(), src.typeIndex())
+    {}
+
+    const_vector_ref(const vector_ref& src) :
+        const_vector_ref(src.mData, src.mSize, src.mStride, src.mIndex)
+    {}
+
+    const_value_ref operator[](const size_t index) const
+    {
+        return const_value_ref(mData + index * mStride, mIndex);
+    }
+
+    constexpr size_t size() const
+    {
+        return mSize;
+    }
+
+    // Returns a pointer to the first byte of the underlying storage
+    constexpr const uint8_t* data() const
+    {
+        return mData;
+    }
+
+    // Returns the number of bytes occupied by each element
+    constexpr uint32_t stride() const
+    {
+        return mStride;
+    }
+
+    // Returns a view of 'count' elements starting at element 'first'
+    const_vector_ref slice(const size_t first, const size_t count) const
+    {
+        return const_vector_ref(mData + first * mStride, count, mStride, mIndex);
+    }
+
+    // Returns the index of the currently active type
+    constexpr uint32_t typeIndex() const
+    {
+        return mIndex;
+    }
+
+private:
+    const_vector_ref(const uint8_t* data, size_t size, uint32_t stride, uint32_t index) :
+        mData(data),
+        mSize(size),
+        mStride(stride),
+        mIndex(index)
+    {}
+
+    const uint8_t* mData;
+    size_t mSize;
+    uint32_t mStride;
+    uint32_t mIndex;
+};
+
 }
@@ -0,0 +1,8 @@
+// Compiled definitions of the flt bulk kernels (the flt_kernels target).
+// Including the headers here, with FLT_PRECOMPILED_KERNELS and
+// FLT_BUILDING_KERNELS both defined, gives every kernel entry point a single
+// external definition. That instantiates each type- and ISA-specialized loop
+// exactly once, for all type combinations, instead of once per translation
+// unit that uses it.
+#define FLT_BUILDING_KERNELS
+#include "flt/flt.h"
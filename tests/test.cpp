@@ -5,7 +5,14 @@
 // #include <chrono>
 // #include <cmath>
 
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
 #include "flt/flt.h"
 
 // Returns the current system time (UNIX timestamp) in seconds with millisecond
@@ -17,8 +24,13 @@ inline double currentTimeSeconds()
     ).count() / 1000.0;
 }
 
-// Floating point equality comparison macro
-#define ASSERT_EQUAL(v1, v2) assert(std::abs((v1) - (v2)) < 1E-8)
+// Floating point equality comparison macro. The operands are still referenced
+// when assert() is compiled out, so locals used only here stay 'used'.
+#ifdef NDEBUG
+    #define ASSERT_EQUAL(v1, v2) ((void) (v1), (void) (v2))
+#else
+    #define ASSERT_EQUAL(v1, v2) assert(std::abs((v1) - (v2)) < 1E-8)
+#endif
 
 void testSimpleAssignment()
 {
@@ -242,6 +254,722 @@ void testTypeConversions()
     std::cout << "Type Conversions - Pass" << std::endl;
 }
 
+void testPipeline()
+{
+    std::vector<double> orig(100000);
+    for (size_t i = 0; i < orig.size(); ++i)
+        orig[i] = (double) i;
+    flt::vector_ref vec(orig);
+
+    // Two element-wise stages that should be fused, followed by a reduction
+    // that sees whole blocks in order.
+    double sum         = 0.0;
+    size_t nextOffset  = 0;
+    bool inOrder       = true;
+    flt::pipeline p(4096);
+    p.add_elementwise("scale", [](flt::vector_ref block, size_t)
+    {
+        for (size_t i = 0; i < block.size(); ++i)
+            block[i] *= 2.0;
+    });
+    p.add_elementwise("offset", [](flt::vector_ref block, size_t)
+    {
+        for (size_t i = 0; i < block.size(); ++i)
+            block[i] += 1.0;
+    });
+    p.add("reduce", [&](flt::vector_ref block, size_t offset)
+    {
+        inOrder    = inOrder && (offset == nextOffset);
+        nextOffset = offset + block.size();
+        for (size_t i = 0; i < block.size(); ++i)
+            sum += block[i].as<double>();
+    });
+    assert(p.threads() == 2);
+    p.run(vec);
+
+    [[maybe_unused]] const double n = (double) orig.size();
+    assert(inOrder);
+    ASSERT_EQUAL(sum, n * (n - 1.0) + n);
+    ASSERT_EQUAL(orig[10], 21.0);
+
+    [[maybe_unused]] const auto& stats = p.stats();
+    assert(stats.size() == 3);
+    assert(stats[2].name == "reduce");
+    assert(stats[2].elements == orig.size());
+    assert(stats[2].blocks == (orig.size() * sizeof(double) + 4095) / 4096);
+    assert(stats[0].blocks == stats[2].blocks);
+
+    // Exceptions thrown by a stage are passed back to the caller
+    flt::pipeline failing(4096);
+    failing.add("throw", [](flt::vector_ref, size_t offset)
+    {
+        if (offset > 0)
+            throw std::runtime_error("stage failure");
+    });
+    failing.add("noop", [](flt::vector_ref, size_t) {});
+
+    [[maybe_unused]] bool caught = false;
+    try
+    {
+        failing.run(vec);
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    assert(caught);
+
+    std::cout << "Pipeline - Pass" << std::endl;
+}
+
+void testChain()
+{
+    using namespace flt;
+
+    std::vector<float>  xs(1500);
+    std::vector<cfloat> ys(1500);
+    std::vector<double> out(1500);
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        xs[i] = 0.5f * i;
+        ys[i] = cfloat(1.0f, 0.25f * i);
+    }
+
+    // out = |x * conj(y) * 2 + x|
+    flt::chain c;
+    auto x = c.input(0);
+    auto y = c.input(1);
+    c.input(1); // Unused operations should not affect the result
+    c.abs(c.add(c.scale(c.mul(x, c.conj(y)), 2.0f), x));
+
+    assert(c.workingType({vector_ref(xs), vector_ref(ys)}) == 2);
+    c.eval({vector_ref(xs), vector_ref(ys)}, vector_ref(out));
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        [[maybe_unused]] const cfloat expected = xs[i] * std::conj(ys[i]) * 2.0f + xs[i];
+        assert(std::abs(out[i] - std::abs(expected)) < 1E-3 * std::abs(expected) + 1E-6);
+    }
+
+    // Conversion to a real type drops the imaginary part
+    std::vector<cdouble> complexOut(1500);
+    flt::chain d;
+    d.add(d.convert(d.input(0), 0), d.input(1));
+    d.eval({vector_ref(ys), vector_ref(xs)}, vector_ref(complexOut));
+    for (size_t i = 0; i < xs.size(); ++i)
+        ASSERT_EQUAL(complexOut[i], cdouble(1.0 + xs[i], 0.0));
+
+    std::cout << "Chain - Pass" << std::endl;
+}
+
+void testKernel()
+{
+    using namespace flt;
+
+    std::vector<float>   xs(100);
+    std::vector<cdouble> ys(100);
+    std::vector<cfloat>  out(100);
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        xs[i] = 1.0f + i;
+        ys[i] = cdouble(2.0, 0.5 * i);
+    }
+
+    vector_ref xRef(xs);
+    vector_ref yRef(ys);
+    vector_ref outRef(out);
+
+    // Every instruction set should produce the same result
+    for (isa target : {isa::generic, isa::avx2, isa::avx512})
+    {
+        kernel k(kernel_op::mul, outRef, xRef, yRef, target);
+        assert(k.target() <= detectIsa());
+
+        k(outRef, xRef, yRef);
+        for (size_t i = 0; i < xs.size(); ++i)
+            ASSERT_EQUAL(std::abs(out[i] - cfloat((double) xs[i] * ys[i])), 0.0f);
+    }
+
+    kernel sub(kernel_op::sub, 2, 0, 3);
+    sub(outRef, xRef, yRef);
+    ASSERT_EQUAL(out[3], cfloat(4.0f - 2.0f, -1.5f));
+
+    // Operands whose types no longer match the kernel are rejected
+    std::vector<double> doubles(100);
+    [[maybe_unused]] bool caught = false;
+    try
+    {
+        sub(outRef, vector_ref(doubles), yRef);
+    }
+    catch (const std::invalid_argument&)
+    {
+        caught = true;
+    }
+    assert(caught);
+
+    std::cout << "Kernel - Pass" << std::endl;
+}
+
+#if FLT_X86_DISPATCH
+// Returns true if the machine code of 'fn' starts with a jump, i.e. it is only
+// a tail call to code compiled elsewhere
+template <class F>
+bool isTailCall(F fn)
+{
+    const uint8_t* code = reinterpret_cast<const uint8_t*>(fn);
+    if (code[0] == 0xF3 && code[1] == 0x0F && code[2] == 0x1E && code[3] == 0xFA) // endbr64
+        code += 4;
+    return code[0] == 0xE9 || code[0] == 0xEB;
+}
+
+// Only optimized builds can lose the inlined loop, and those compile assert()
+// out, so a failure throws instead
+template <auto Loop>
+void checkIsaVariants(const char* name)
+{
+    using variants = flt::isa_variants<Loop>;
+    if (isTailCall(&variants::avx2) || isTailCall(&variants::avx512))
+        throw std::runtime_error(std::string(name) + ": ISA variant does not contain its own loop");
+}
+#endif
+
+void testIsaVariants()
+{
+#if FLT_X86_DISPATCH
+    using namespace flt;
+    checkIsaVariants<&binaryLoop<std::multiplies<>, float, float, float>>("binaryLoop");
+    checkIsaVariants<&iirInterleavedLoop<cfloat>>("iirInterleavedLoop");
+    checkIsaVariants<&gemmPanel<float, cfloat, cdouble>>("gemmPanel");
+    checkIsaVariants<&philoxFillLoop<float>>("philoxFillLoop");
+    checkIsaVariants<&philoxFillLoop<double>>("philoxFillLoop");
+    checkIsaVariants<&resampleLoop<double, 2>>("resampleLoop");
+    checkIsaVariants<&decodeBlockLoop<uint64_t, 1, sparse_expand_shuffle>>("decodeBlockLoop");
+#endif
+
+    std::cout << "ISA Variants - Pass" << std::endl;
+}
+
+void testMultichannel()
+{
+    using namespace flt;
+
+    const size_t C = 8;
+    const size_t F = 300;
+    const std::vector<double> b {0.2, 0.3, 0.1};
+    const std::vector<double> a {-0.5, 0.25};
+
+    // Reference: the direct form filter used by performanceTest()
+    auto reference = [&](const std::vector<cfloat>& x)
+    {
+        std::vector<cfloat> y(x.size(), cfloat(0.0f));
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            for (size_t j = 0; j < b.size() && j <= i; ++j)
+                y[i] += (float) b[j] * x[i - j];
+            for (size_t j = 0; j < a.size() && j + 1 <= i; ++j)
+                y[i] -= (float) a[j] * y[i - j - 1];
+        }
+        return y;
+    };
+
+    for (channel_layout layout : {channel_layout::interleaved, channel_layout::planar})
+    {
+        multichannel x(C, F, cfloat(0.0f), layout);
+        std::vector<std::vector<cfloat>> inputs(C, std::vector<cfloat>(F));
+        for (size_t c = 0; c < C; ++c)
+        {
+            for (size_t f = 0; f < F; ++f)
+            {
+                inputs[c][f] = cfloat(std::sin(0.1f * f + c), (float) c);
+                x(c, f)      = inputs[c][f];
+            }
+        }
+
+        // Filter in two blocks to exercise the saved state
+        multichannel_iir filter(b, a, C);
+        multichannel first(C, 100, cfloat(0.0f), layout);
+        multichannel second(C, F - 100, cfloat(0.0f), layout);
+        for (size_t c = 0; c < C; ++c)
+            for (size_t f = 0; f < F; ++f)
+                (f < 100 ? first(c, f) : second(c, f - 100)) = x(c, f);
+
+        filter.process(first);
+        filter.process(second);
+        gain(second, 2.0);
+
+        for (size_t c = 0; c < C; ++c)
+        {
+            const std::vector<cfloat> expected = reference(inputs[c]);
+            for (size_t f = 0; f < F; ++f)
+            {
+                [[maybe_unused]] const cfloat actual = f < 100 ?
+                    first(c, f).as<cfloat>() : 0.5f * second(c, f - 100).as<cfloat>();
+                assert(std::abs(actual - expected[f]) < 1E-4);
+            }
+        }
+    }
+
+    // Mix 3 channels down to 2
+    multichannel src(3, 10, 1.0, channel_layout::planar);
+    multichannel dst(2, 10, 0.0);
+    for (size_t f = 0; f < 10; ++f)
+        src(2, f) = 2.0;
+    mix(src, {1.0, 1.0, 1.0, 0.5, 0.0, 0.25}, dst);
+    ASSERT_EQUAL(dst(0, 7).as<double>(), 4.0);
+    ASSERT_EQUAL(dst(1, 7).as<double>(), 1.0);
+
+    multichannel planarDst(2, 10, 0.0, channel_layout::planar);
+    mix(src, {1.0, 1.0, 1.0, 0.5, 0.0, 0.25}, planarDst);
+    ASSERT_EQUAL(planarDst(0, 7).as<double>(), 4.0);
+    ASSERT_EQUAL(planarDst(1, 7).as<double>(), 1.0);
+
+    std::cout << "Multichannel - Pass" << std::endl;
+}
+
+void testMatrix()
+{
+    using namespace flt;
+
+    const size_t M = 70, N = 37, K = 300;
+    std::vector<float>  a(M * K);
+    std::vector<cfloat> b(K * N);
+    std::vector<cdouble> c(M * N, cdouble(1.0, 1.0));
+    for (size_t i = 0; i < a.size(); ++i)
+        a[i] = std::sin(0.01f * i);
+    for (size_t i = 0; i < b.size(); ++i)
+        b[i] = cfloat(std::cos(0.02f * i), 0.5f);
+
+    // Real (row-major) x complex (column-major), accumulated into complex
+    // (column-major with padding), with alpha and beta
+    matrix_ref aRef(a, M, K);
+    matrix_ref bRef(b, K, N, matrix_layout::col_major);
+    std::vector<cdouble> cPadded((M + 3) * N, cdouble(1.0, 1.0));
+    matrix_ref cRef(cPadded, M, N, matrix_layout::col_major, M + 3);
+    gemm(aRef, bRef, cRef, 2.0f, 0.5f, 3);
+
+    for (size_t i = 0; i < M; ++i)
+    {
+        for (size_t j = 0; j < N; ++j)
+        {
+            cfloat sum(0.0f);
+            for (size_t p = 0; p < K; ++p)
+                sum += a[i * K + p] * b[j * K + p];
+
+            [[maybe_unused]] const cdouble expected = 2.0 * cdouble(sum) + 0.5 * cdouble(1.0, 1.0);
+            assert(std::abs(cRef(i, j).as<cdouble>() - expected) < 1E-3);
+        }
+    }
+
+    // gemv in both layouts matches gemm with a single column
+    std::vector<double> x(K);
+    for (size_t i = 0; i < K; ++i)
+        x[i] = 1.0 / (i + 1);
+
+    matrix aCol(M, K, 0.0f, matrix_layout::col_major);
+    transpose(aRef.transposed(), matrix_ref(aCol));
+    for (size_t i = 0; i < M; ++i)
+        for (size_t j = 0; j < K; ++j)
+            assert(aCol(i, j).as<float>() == a[i * K + j]);
+
+    std::vector<double> yRow(M, 5.0), yCol(M, 5.0), yGemm(M);
+    gemv(aRef, vector_ref(x), vector_ref(yRow));
+    gemv(matrix_ref(aCol), vector_ref(x), vector_ref(yCol), 1.0, 0.0, 2);
+    gemm(aRef, matrix_ref(x, K, 1), matrix_ref(yGemm, M, 1));
+    for (size_t i = 0; i < M; ++i)
+    {
+        assert(std::abs(yRow[i] - yGemm[i]) < 1E-9);
+        assert(std::abs(yCol[i] - yGemm[i]) < 1E-9);
+    }
+
+    // Blocked transpose with conversion
+    std::vector<double> t(K * M);
+    transpose(aRef, matrix_ref(t, K, M), 2);
+    for (size_t i = 0; i < M; ++i)
+        for (size_t j = 0; j < K; ++j)
+            assert(t[j * M + i] == a[i * K + j]);
+
+    std::cout << "Matrix - Pass" << std::endl;
+}
+
+void testViews()
+{
+    using namespace flt;
+
+    static_assert(  std::is_constructible_v< const_vector_ref, const std::vector<float>& >, "Construction error" );
+    static_assert(  std::is_constructible_v< const_vector_ref, const cdouble*, size_t >,     "Construction error" );
+    static_assert(  std::is_constructible_v< const_vector_ref, vector_ref >,                 "Construction error" );
+    static_assert( !std::is_constructible_v< vector_ref, const std::vector<float>& >,       "Construction error" );
+    static_assert( !std::is_constructible_v< vector_ref, const_vector_ref >,                 "Construction error" );
+
+    // Raw memory, e.g. from a C API
+    std::array<cfloat, 4> raw {cfloat(1.0f, 1.0f), cfloat(2.0f), cfloat(3.0f), cfloat(4.0f)};
+    vector_ref rawRef(raw.data(), raw.size());
+    rawRef[1] *= 2.0f;
+    ASSERT_EQUAL(raw[1], cfloat(4.0f));
+    assert(rawRef.typeIndex() == 2);
+
+    // Read-only inputs
+    const std::vector<double> constant {1.0, 2.0, 3.0, 4.0};
+    const_vector_ref constRef(constant);
+    ASSERT_EQUAL(constRef[2].as<double>(), 3.0);
+    ASSERT_EQUAL(constRef.slice(1, 2)[1].as<double>(), 3.0);
+
+    // flt::vector can be viewed without copying
+    flt::vector owned(4, 0.5f);
+    vector_ref ownedRef(owned);
+    ownedRef[3] = 1.5f;
+    ASSERT_EQUAL(owned[3].as<float>(), 1.5f);
+
+    // Const views can be passed straight to the bulk operations
+    kernel add(kernel_op::add, rawRef, constRef, rawRef);
+    add(rawRef, constRef, rawRef);
+    ASSERT_EQUAL(raw[0], cfloat(2.0f, 1.0f));
+    ASSERT_EQUAL(raw[3], cfloat(8.0f));
+
+    std::cout << "Views - Pass" << std::endl;
+}
+
+void testIndexing()
+{
+    using namespace flt;
+
+    const size_t N = 203;
+    std::vector<float>  table(64);
+    std::vector<cfloat> ctable(64);
+    for (size_t i = 0; i < table.size(); ++i)
+    {
+        table[i]  = 0.5f * i;
+        ctable[i] = cfloat(i, -1.0f * i);
+    }
+
+    std::vector<int32_t> indices(N);
+    for (size_t i = 0; i < N; ++i)
+        indices[i] = (int32_t) ((i * 37) % table.size());
+
+    // Every instruction set the CPU supports takes its own code path
+    for (isa target : {isa::generic, isa::avx2, isa::avx512})
+    {
+        if (target > detectIsa())
+            continue;
+
+        // Gather, with and without a type conversion
+        std::vector<float>   gathered(N);
+        std::vector<double>  converted(N);
+        std::vector<cfloat>  cgathered(N);
+        gather(const_vector_ref(table), indices, vector_ref(gathered), target);
+        gather(const_vector_ref(table), indices, vector_ref(converted), target);
+        gather(const_vector_ref(ctable), indices, vector_ref(cgathered), target);
+        for (size_t i = 0; i < N; ++i)
+        {
+            assert(gathered[i] == table[indices[i]]);
+            assert(converted[i] == table[indices[i]]);
+            assert(cgathered[i] == ctable[indices[i]]);
+        }
+
+        // Scatter is the inverse of gather for a permutation
+        std::vector<int32_t> perm(table.size());
+        for (size_t i = 0; i < perm.size(); ++i)
+            perm[i] = (int32_t) ((i * 5) % perm.size());
+        std::vector<float> permuted(table.size()), restored(table.size());
+        gather(const_vector_ref(table), perm, vector_ref(permuted), target);
+        scatter(const_vector_ref(permuted), perm, vector_ref(restored), target);
+        assert(restored == table);
+
+        std::vector<cfloat> cpermuted(ctable.size()), crestored(ctable.size());
+        gather(const_vector_ref(ctable), perm, vector_ref(cpermuted), target);
+        scatter(const_vector_ref(cpermuted), perm, vector_ref(crestored), target);
+        assert(crestored == ctable);
+
+        // Compare against a vector and a threshold, then select
+        std::vector<double> a(N), b(N), out(N);
+        for (size_t i = 0; i < N; ++i)
+        {
+            a[i] = std::sin(0.1 * i);
+            b[i] = std::cos(0.1 * i);
+        }
+
+        mask m;
+        compare(vector_ref(a), vector_ref(b), compare_op::less, m, target);
+        assert(m.size() == N);
+        for (size_t i = 0; i < N; ++i)
+            assert(m[i] == (a[i] < b[i]));
+
+        select(m, vector_ref(a), vector_ref(b), vector_ref(out), target);
+        for (size_t i = 0; i < N; ++i)
+            assert(out[i] == std::min(a[i], b[i]));
+
+        compare(vector_ref(a), 0.25, compare_op::greater_equal, m, target);
+        for (size_t i = 0; i < N; ++i)
+            assert(m[i] == (a[i] >= 0.25));
+
+        std::vector<float> af(a.begin(), a.end()), bf(b.begin(), b.end());
+        compare(vector_ref(af), vector_ref(bf), compare_op::not_equal, m, target);
+        for (size_t i = 0; i < N; ++i)
+            assert(m[i] == (af[i] != bf[i]));
+
+        // Selecting into one of the inputs only replaces the selected elements
+        std::vector<float> fa(N, 1.0f), fb(N, 2.0f);
+        compare(vector_ref(af), 0.0f, compare_op::less, m, target);
+        select(m, vector_ref(fa), vector_ref(fb), vector_ref(fb), target);
+        for (size_t i = 0; i < N; ++i)
+            assert(fb[i] == (a[i] < 0.0 ? 1.0f : 2.0f));
+        assert(m.count() == (size_t) std::count_if(a.begin(), a.end(), [](double x) { return x < 0.0; }));
+
+        // Complex values are ordered by magnitude
+        std::vector<cfloat> c {cfloat(3.0f, 4.0f), cfloat(1.0f, 0.0f), cfloat(0.0f, -6.0f)};
+        compare(vector_ref(c), 5.0f, compare_op::less, m, target);
+        assert(!m[0] && m[1] && !m[2]);
+    }
+
+    std::cout << "Indexing - Pass" << std::endl;
+}
+
+void testRandom()
+{
+    using namespace flt;
+
+    // Known-answer vectors for Philox4x32-10
+    [[maybe_unused]] const auto zero = philox::block({0, 0, 0, 0}, {0, 0});
+    assert((zero == std::array<uint32_t, 4> {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    [[maybe_unused]] const auto ones = philox::block({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff});
+    assert((ones == std::array<uint32_t, 4> {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+
+    const size_t N = 100003;
+    philox rng(1234);
+
+    // The values do not depend on the number of threads or on how the
+    // sequence is split into blocks
+    std::vector<float> f1(N), f4(N), pieces(N);
+    rng.uniform(vector_ref(f1), -1.0, 3.0, 0, 1);
+    rng.uniform(vector_ref(f4), -1.0, 3.0, 0, 4);
+    assert(f1 == f4);
+    rng.uniform(vector_ref(pieces.data(), 333), -1.0, 3.0, 0, 3);
+    rng.uniform(vector_ref(pieces.data() + 333, N - 333), -1.0, 3.0, 333, 3);
+    assert(pieces == f1);
+
+    double sum = 0.0;
+    for (float x : f1)
+    {
+        assert(x >= -1.0f && x < 3.0f);
+        sum += x;
+    }
+    assert(std::abs(sum / N - 1.0) < 0.02);
+
+    // Different streams are different sequences
+    std::vector<float> other(N);
+    philox(1234, 1).uniform(vector_ref(other), -1.0, 3.0);
+    assert(other != f1);
+
+    // Normal moments
+    std::vector<double> d1(N), d3(N);
+    rng.normal(vector_ref(d1), 2.0, 0.5, 0, 1);
+    rng.normal(vector_ref(d3), 2.0, 0.5, 0, 3);
+    assert(d1 == d3);
+
+    double mean = 0.0, var = 0.0;
+    for (double x : d1)
+        mean += x;
+    mean /= N;
+    for (double x : d1)
+        var += (x - mean) * (x - mean);
+    var /= N;
+    assert(std::abs(mean - 2.0) < 0.01);
+    assert(std::abs(var - 0.25) < 0.01);
+
+    // Circular complex normal: independent parts with half the variance each
+    std::vector<cfloat> c(N);
+    rng.normal(vector_ref(c), value(cfloat(1.0f, -1.0f)), 2.0);
+    cdouble cmean(0.0, 0.0);
+    double power = 0.0, cross = 0.0;
+    for (const cfloat& z : c)
+        cmean += cdouble(z);
+    cmean /= double(N);
+    for (const cfloat& z : c)
+    {
+        const cdouble d = cdouble(z) - cmean;
+        power += std::norm(d);
+        cross += d.real() * d.imag();
+    }
+    assert(std::abs(cmean - cdouble(1.0, -1.0)) < 0.03);
+    assert(std::abs(power / N - 4.0) < 0.1);
+    assert(std::abs(cross / N) < 0.05);
+
+    std::cout << "Random - Pass" << std::endl;
+}
+
+void testResampler()
+{
+    using namespace flt;
+
+    // Direct evaluation of the upsample - filter - decimate definition
+    auto reference = [](const auto& x, size_t up, size_t down, const std::vector<double>& h)
+    {
+        using T = typename std::decay_t<decltype(x)>::value_type;
+        std::vector<T> y;
+        for (size_t t = 0; t < x.size() * up; t += down)
+        {
+            T sum(0);
+            for (size_t k = 0; k <= t && k < h.size(); ++k)
+            {
+                if ((t - k) % up == 0)
+                    sum += T(h[k]) * x[(t - k) / up];
+            }
+            y.push_back(sum);
+        }
+        return y;
+    };
+
+    std::vector<double> h(37);
+    for (size_t i = 0; i < h.size(); ++i)
+        h[i] = std::sin(0.3 * i + 0.1) / (1.0 + i);
+
+    const size_t N = 1000;
+    std::vector<double> x(N);
+    std::vector<cfloat> cx(N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        x[i]  = std::cos(0.05 * i) + 0.25 * std::sin(0.7 * i);
+        cx[i] = cfloat(std::cos(0.02 * i), std::sin(0.03 * i));
+    }
+
+    const std::array<std::array<size_t, 2>, 5> factors {{{1, 1}, {3, 2}, {2, 3}, {1, 4}, {160, 147}}};
+    for (const auto& f : factors)
+    {
+        const std::vector<double> expected   = reference(x, f[0], f[1], h);
+        const std::vector<cfloat> cexpected  = reference(cx, f[0], f[1], h);
+
+        // One call
+        resampler r(f[0], f[1], h);
+        std::vector<double> y(r.outputSize(N));
+        assert(y.size() == expected.size());
+        assert(r.process(vector_ref(x), vector_ref(y)) == y.size());
+        for (size_t i = 0; i < y.size(); ++i)
+            ASSERT_EQUAL(y[i], expected[i]);
+
+        // Streaming in uneven blocks gives the same result
+        resampler rc(f[0], f[1], h);
+        std::vector<cfloat> cy(cexpected.size());
+        size_t written = 0;
+        for (size_t first = 0, block = 1; first < N; first += block, block = block * 3 + 1)
+        {
+            const size_t n = std::min(block, N - first);
+            written += rc.process(vector_ref(cx.data() + first, n),
+                vector_ref(cy.data() + written, cy.size() - written));
+        }
+        assert(written == cexpected.size());
+        for (size_t i = 0; i < cy.size(); ++i)
+            assert(std::abs(cy[i] - cexpected[i]) < 1E-4);
+    }
+
+    std::cout << "Resampler - Pass" << std::endl;
+}
+
+void testCompressed()
+{
+    using namespace flt;
+
+    const size_t N = 10007;
+    std::vector<float>   f(N);
+    std::vector<double>  d(N);
+    std::vector<cfloat>  cf(N);
+    std::vector<cdouble> cd(N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        f[i]  = std::round(1000.0f * std::sin(0.01f * i));
+        d[i]  = std::sin(0.001 * i) + (i % 97 == 0 ? 1E-9 : 0.0);
+        cf[i] = cfloat(std::cos(0.02f * i), std::sin(0.02f * i));
+        cd[i] = cdouble(i, -0.5 * i);
+    }
+
+    auto roundTrip = [](auto& data, size_t threads, size_t blockElements)
+    {
+        using T = typename std::decay_t<decltype(data)>::value_type;
+        compressed c(const_vector_ref(data), threads, blockElements);
+        assert(c.size() == data.size());
+        assert(c.blocks() == (data.size() + blockElements - 1) / blockElements);
+
+        // Through the serialized form, decoding into a new flt::vector
+        compressed loaded(c.bytes());
+        flt::vector restored = loaded.decode(3);
+        assert(restored.typeIndex() == index_of<T>());
+        assert(std::memcmp(restored.data(), data.data(), data.size() * sizeof(T)) == 0);
+
+        // One block on its own
+        const index_range r = c.blockRange(1);
+        std::vector<T> block(r.end - r.begin);
+        c.decodeBlock(1, vector_ref(block));
+        assert(std::equal(block.begin(), block.end(), data.begin() + r.begin));
+        return c.bytes().size();
+    };
+
+    // Smooth or repetitive data compresses, and the thread count does not
+    // change the encoding
+    assert(roundTrip(f, 1, 1000) < N * sizeof(float) / 2);
+    roundTrip(d, 4, 4096);
+    roundTrip(cf, 2, 999);
+    assert(roundTrip(cd, 3, 2048) < N * sizeof(cdouble) / 2);
+    assert(compressed(const_vector_ref(f), 1).bytes() == compressed(const_vector_ref(f), 4).bytes());
+
+    // Special values survive bit-exactly
+    std::vector<double> special {0.0, -0.0, 1E-310, std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN(), 1.0};
+    compressed s(const_vector_ref(special), 1, 3);
+    std::vector<double> restored(special.size());
+    s.decode(vector_ref(restored));
+    assert(std::memcmp(restored.data(), special.data(), special.size() * sizeof(double)) == 0);
+
+    // Damaged containers are rejected rather than decoded
+    std::vector<uint8_t> bytes = compressed(const_vector_ref(f), 1, 1000).bytes();
+    [[maybe_unused]] bool caught = false;
+    try
+    {
+        compressed(std::vector<uint8_t>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+    }
+    catch (const std::invalid_argument&)
+    {
+        caught = true;
+    }
+    assert(caught);
+
+    std::cout << "Compressed - Pass" << std::endl;
+}
+
+void testAllocation()
+{
+    using namespace flt;
+
+    // Small vectors are cache line aligned
+    flt::vector small(3, 1.5);
+    assert((uintptr_t) small.data() % VECTOR_ALIGNMENT == 0);
+    assert(small[2].as<double>() == 1.5);
+
+    // Large vectors are huge page aligned and filled in parallel
+    allocation_policy policy;
+    policy.threads    = 4;
+    policy.largeBytes = 1 << 20;
+
+    const size_t N = 300001;
+    flt::vector large(N, cfloat(1.0f, -2.0f), policy);
+    assert((uintptr_t) large.data() % HUGE_PAGE_BYTES == 0);
+    [[maybe_unused]] const cfloat* values = (const cfloat*) large.data();
+    assert(std::all_of(values, values + N, [](const cfloat& x) { return x == cfloat(1.0f, -2.0f); }));
+
+    policy.hugePages = false;
+    flt::vector plain(N, 0.25, policy);
+    assert((uintptr_t) plain.data() % VECTOR_ALIGNMENT == 0);
+    [[maybe_unused]] const double* doubles = (const double*) plain.data();
+    assert(std::all_of(doubles, doubles + N, [](double x) { return x == 0.25; }));
+
+    // Moving transfers ownership
+    flt::vector moved(std::move(large));
+    assert(moved.size() == N && large.size() == 0);
+    assert(moved[N - 1].as<cfloat>() == cfloat(1.0f, -2.0f));
+
+    flt::vector empty(0, 1.0f);
+    assert(empty.size() == 0);
+
+    std::cout << "Allocation - Pass" << std::endl;
+}
+
 void performanceTest()
 {
     auto m = [](const auto& b, const auto& a, const auto& x, auto& y) constexpr
@@ -312,6 +1040,18 @@ int main()
     testCompoundAssignmentRef();
     testBinaryOps();
     testTypeConversions();
+    testPipeline();
+    testChain();
+    testKernel();
+    testIsaVariants();
+    testMultichannel();
+    testMatrix();
+    testViews();
+    testIndexing();
+    testRandom();
+    testResampler();
+    testCompressed();
+    testAllocation();
 
     performanceTest();
     return 0;